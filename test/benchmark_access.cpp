@@ -0,0 +1,382 @@
+#include <trace/FrameSearch.h>
+#include <trace/Trace.h>
+#include <trace/TraceDiff.h>
+
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::NibbleTrace;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+// a trace with one change every 1-3 simcycles
+template <class Trace> void fill_trace(Trace &trace, std::size_t length) {
+  std::vector<DeltaTime> times(length);
+  std::vector<Bit> values(length);
+  Time cycle = 0;
+  for (size_t i = 0; i < length; ++i) {
+    cycle += 1 + i % 3;
+    times[i] = DeltaTime(cycle, i % 4);
+    values[i] = i % 2;
+  }
+  trace.appendBatch(&times[0], &values[0], length);
+}
+
+// linear congruential generator, cheap enough not to dominate the lookup
+struct RandomTimes {
+  RandomTimes(Time maxCycle) : _state(12345), _maxCycle(maxCycle) {}
+
+  DeltaTime next() {
+    _state = _state * 6364136223846793005ull + 1442695040888963407ull;
+    return DeltaTime((_state >> 16) % _maxCycle, (_state >> 8) & 3);
+  }
+
+  Time _state;
+  Time _maxCycle;
+};
+}
+
+// fill_trace only writes 0 and 1, a trailing third value converts the trace
+// to the general form. A compacted trace reports the memory its pool held
+// before compacting relative to after.
+template <class Trace>
+static void get_random(benchmark::State &state, bool twoState,
+                       bool compact = false) {
+  Trace trace(0);
+  fill_trace(trace, state.range_x());
+  if (!twoState) {
+    trace.set(2, DeltaTime(trace.lastCheckpoint().simcycle() + 1, 0));
+  }
+  if (compact) {
+    std::size_t bytes = trace.framePool()->statistics().bytes;
+    trace.compact();
+    std::ostringstream label;
+    label << "memory / "
+          << double(bytes) / trace.framePool()->statistics().bytes;
+    state.SetLabel(label.str());
+  }
+  RandomTimes random(trace.lastCheckpoint().simcycle());
+
+  Bit sum = 0;
+  while (state.KeepRunning()) {
+    sum += trace.get(random.next());
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class Trace> static void BM_get_random(benchmark::State &state) {
+  get_random<Trace>(state, true);
+}
+
+template <class Trace>
+static void BM_get_random_general(benchmark::State &state) {
+  get_random<Trace>(state, false);
+}
+
+template <class Trace>
+static void BM_get_random_compacted(benchmark::State &state) {
+  get_random<Trace>(state, true, true);
+}
+
+template <class Trace>
+static void BM_get_random_general_compacted(benchmark::State &state) {
+  get_random<Trace>(state, false, true);
+}
+
+static void BM_checkpoint_random(benchmark::State &state) {
+  Trace trace(0);
+  fill_trace(trace, state.range_x());
+  RandomTimes random(trace.lastCheckpoint().simcycle());
+
+  Time sum = 0;
+  while (state.KeepRunning()) {
+    sum += trace.checkpoint(random.next()).simcycle();
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_get_random, Trace)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+BENCHMARK_TEMPLATE(BM_get_random, NibbleTrace)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+BENCHMARK_TEMPLATE(BM_get_random_general, Trace)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+BENCHMARK_TEMPLATE(BM_get_random_compacted, Trace)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+BENCHMARK_TEMPLATE(BM_get_random_general_compacted, Trace)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+BENCHMARK(BM_checkpoint_random)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+
+template <class Trace>
+static void iterate(benchmark::State &state, bool compact) {
+  Trace trace(0);
+  fill_trace(trace, state.range_x());
+  if (compact) {
+    trace.compact();
+  }
+
+  Time sum = 0;
+  while (state.KeepRunning()) {
+    for (typename Trace::const_iterator it = trace.begin(), end = trace.end();
+         it != end; ++it) {
+      sum += it.value();
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+template <class Trace> static void BM_iterate(benchmark::State &state) {
+  iterate<Trace>(state, false);
+}
+
+template <class Trace>
+static void BM_iterate_compacted(benchmark::State &state) {
+  iterate<Trace>(state, true);
+}
+
+template <class Trace>
+static void BM_compute_values(benchmark::State &state) {
+  Trace trace(0);
+  fill_trace(trace, state.range_x());
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(trace.computeValues());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+BENCHMARK_TEMPLATE(BM_iterate, Trace)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_iterate, NibbleTrace)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_iterate_compacted, Trace)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_compute_values, Trace)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_compute_values, NibbleTrace)->Arg(1 << 20);
+
+// the second Trace of a comparison, see compare()
+enum CompareCase {
+  COMPARE_EQUAL,      // built the same way, equal frames
+  COMPARE_CLONE,      // a clone, all frames shared
+  COMPARE_SHIFTED,    // equal, but no frame boundary lines up
+  COMPARE_LAST_DIFFERS // the value of the last checkpoint differs
+};
+
+static const char *const CompareCaseNames[] = {"equal", "clone", "shifted",
+                                               "last differs"};
+
+static void no_log(DeltaTime, Bit, Bit) {}
+
+// compare two Traces of range_x checkpoints, range_y is the CompareCase.
+// With the log the comparison goes through compare_traces.
+static void compare(benchmark::State &state, bool log) {
+  const std::size_t length = state.range_x();
+  const CompareCase compareCase = CompareCase(state.range_y());
+  Trace a(0);
+  fill_trace(a, length);
+  svt::TracePtr b;
+  if (compareCase == COMPARE_CLONE) {
+    b = a.clone();
+  } else {
+    b = new Trace(0);
+    fill_trace(*b, length);
+  }
+  if (compareCase == COMPARE_SHIFTED) {
+    // a checkpoint keeping the value splits the first frame, the repack
+    // moves every following entry back by one
+    DeltaTime first = b->firstCheckpoint();
+    b->set(b->get(first), DeltaTime(first.simcycle(), first.deltacycle() + 1));
+    b->repack();
+  } else if (compareCase == COMPARE_LAST_DIFFERS) {
+    b->set(2, b->lastCheckpoint());
+  }
+  const bool expected = compareCase != COMPARE_LAST_DIFFERS;
+
+  bool equal = expected;
+  while (state.KeepRunning()) {
+    equal = log ? svt::compare_traces(a, *b, &no_log) : a == *b;
+  }
+  state.SetLabel(equal == expected ? CompareCaseNames[compareCase]
+                                   : "wrong result");
+  state.SetItemsProcessed(state.iterations() * length);
+}
+
+static void BM_equal(benchmark::State &state) { compare(state, false); }
+
+static void BM_compare_traces(benchmark::State &state) {
+  compare(state, true);
+}
+
+BENCHMARK(BM_equal)
+    ->ArgPair(1 << 20, COMPARE_EQUAL)
+    ->ArgPair(1 << 20, COMPARE_CLONE)
+    ->ArgPair(1 << 20, COMPARE_SHIFTED)
+    ->ArgPair(1 << 20, COMPARE_LAST_DIFFERS);
+BENCHMARK(BM_compare_traces)
+    ->ArgPair(1 << 20, COMPARE_EQUAL)
+    ->ArgPair(1 << 20, COMPARE_SHIFTED)
+    ->ArgPair(1 << 20, COMPARE_LAST_DIFFERS);
+
+enum DiffMode {
+  DIFF_LOG,   // compare_traces with a log
+  DIFF_SINK,  // diff_traces with an inlined sink
+  DIFF_BATCH  // TraceDiff::next into a buffer
+};
+
+static std::size_t logged;
+static void count_log(DeltaTime, Bit, Bit) { ++logged; }
+
+struct CountSink {
+  std::size_t *count;
+  void operator()(svt::TraceDifference const &) { ++*count; }
+};
+
+// the differences of a golden Trace of 1 << 20 checkpoints and a copy with
+// a glitch every range_x checkpoints, range_y is the DiffMode
+static void BM_diff(benchmark::State &state) {
+  const std::size_t length = 1 << 20;
+  const std::size_t distance = state.range_x();
+  const DiffMode mode = DiffMode(state.range_y());
+  Trace golden(0);
+  fill_trace(golden, length);
+  Trace dut(0);
+  fill_trace(dut, length);
+  std::vector<DeltaTime> times = golden.computeCheckpoints();
+  for (std::size_t i = distance / 2; i < length; i += distance) {
+    dut.set(2, times[i]);
+  }
+
+  std::size_t found = 0;
+  while (state.KeepRunning()) {
+    found = 0;
+    if (mode == DIFF_LOG) {
+      logged = 0;
+      svt::compare_traces(golden, dut, &count_log);
+      found = logged;
+    } else if (mode == DIFF_SINK) {
+      CountSink sink = {&found};
+      svt::diff_traces(golden, dut, sink);
+    } else {
+      svt::TraceDiff diff(golden, dut);
+      svt::TraceDifference buffer[256];
+      while (!diff.done()) {
+        found += diff.next(buffer, 256);
+      }
+    }
+  }
+  std::ostringstream label;
+  label << found << " differences";
+  state.SetLabel(label.str());
+  state.SetItemsProcessed(state.iterations() * length);
+}
+
+BENCHMARK(BM_diff)
+    ->ArgPair(1 << 4, DIFF_LOG)
+    ->ArgPair(1 << 4, DIFF_SINK)
+    ->ArgPair(1 << 4, DIFF_BATCH)
+    ->ArgPair(1 << 10, DIFF_LOG)
+    ->ArgPair(1 << 10, DIFF_SINK)
+    ->ArgPair(1 << 10, DIFF_BATCH);
+
+// search random times in a sorted array of range_x entries, the sizes
+// correspond to different values of TraceFrameSize
+static void search_frame(benchmark::State &state,
+                         svt::FrameSearchKernel kernel) {
+  if (!svt::select_frame_search(kernel)) {
+    state.SetLabel("not supported by this cpu");
+    while (state.KeepRunning()) {
+    }
+    return;
+  }
+
+  unsigned size = state.range_x();
+  std::vector<svt::PackedDeltaTime> times(size);
+  for (unsigned i = 0; i < size; ++i) {
+    times[i] = DeltaTime(3 * i, i % 4).packed();
+  }
+  RandomTimes random(3 * size);
+
+  unsigned sum = 0;
+  while (state.KeepRunning()) {
+    sum += svt::frame_lower_bound(&times[0], size, random.next().packed());
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+
+  svt::select_frame_search(svt::FRAME_SEARCH_AUTO);
+}
+
+static void BM_search_frame_binary(benchmark::State &state) {
+  search_frame(state, svt::FRAME_SEARCH_BINARY);
+}
+
+static void BM_search_frame_linear(benchmark::State &state) {
+  search_frame(state, svt::FRAME_SEARCH_LINEAR);
+}
+
+static void BM_search_frame_sse42(benchmark::State &state) {
+  search_frame(state, svt::FRAME_SEARCH_SSE42);
+}
+
+static void BM_search_frame_avx2(benchmark::State &state) {
+  search_frame(state, svt::FRAME_SEARCH_AVX2);
+}
+
+BENCHMARK(BM_search_frame_binary)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512)
+    ->Arg(1024);
+BENCHMARK(BM_search_frame_linear)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512)
+    ->Arg(1024);
+BENCHMARK(BM_search_frame_sse42)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512)
+    ->Arg(1024);
+BENCHMARK(BM_search_frame_avx2)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512)
+    ->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -2,21 +2,46 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
 using svt::Trace;
 using svt::DeltaTime;
-using svt::DeltaTimeFW;
+using svt::Time;
 
 static void BM_append(benchmark::State &state) {
-  std::size_t processed;
+  const std::size_t count = state.range_x();
+  std::size_t processed = 0;
+  Trace trace(0);
+  while (state.KeepRunning()) {
+    trace.clear();
+    DeltaTime time(0, 0);
+    uint8_t value = 1;
+    for (size_t i = 0; i < count; ++i) {
+      ++time;
+      value += 1;
+      trace.set(value, time);
+      processed += 1;
+    }
+    benchmark::DoNotOptimize(trace);
+  }
+  state.SetItemsProcessed(processed);
+}
+
+static void BM_append_monotonic(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  std::size_t processed = 0;
   Trace trace(0);
   while (state.KeepRunning()) {
     trace.clear();
     DeltaTime time(0, 0);
     uint8_t value = 1;
-    for (size_t i = 0; i < state.range_x(); ++i) {
+    for (size_t i = 0; i < count; ++i) {
       ++time;
       value += 1;
-      trace.set(value, DeltaTimeFW(time));
+      trace.appendMonotonic(value, time);
       processed += 1;
     }
     benchmark::DoNotOptimize(trace);
@@ -24,6 +49,62 @@ static void BM_append(benchmark::State &state) {
   state.SetItemsProcessed(processed);
 }
 
+static const std::size_t BatchSize = 4096;
+
+static void BM_append_batch(benchmark::State &state) {
+  std::size_t processed = 0;
+  std::vector<DeltaTime> times(state.range_x());
+  std::vector<Bit> values(state.range_x());
+  DeltaTime time(0, 0);
+  uint8_t value = 1;
+  for (size_t i = 0; i < times.size(); ++i) {
+    ++time;
+    value += 1;
+    times[i] = time;
+    values[i] = value;
+  }
+
+  Trace trace(0);
+  while (state.KeepRunning()) {
+    trace.clear();
+    for (size_t i = 0; i < times.size(); i += BatchSize) {
+      std::size_t count = std::min(BatchSize, times.size() - i);
+      trace.appendBatch(&times[i], &values[i], count);
+    }
+    processed += times.size();
+    benchmark::DoNotOptimize(trace);
+  }
+  state.SetItemsProcessed(processed);
+}
+
+static void BM_append_runs(benchmark::State &state) {
+  std::size_t processed = 0;
+  std::vector<Time> runLengths(state.range_x());
+  std::vector<Bit> values(state.range_x());
+  uint8_t value = 1;
+  for (size_t i = 0; i < values.size(); ++i) {
+    value += 1;
+    runLengths[i] = 1 + i % 3;
+    values[i] = value;
+  }
+
+  Trace trace(0);
+  while (state.KeepRunning()) {
+    trace.clear();
+    DeltaTime start(1, 0);
+    for (size_t i = 0; i < values.size(); i += BatchSize) {
+      std::size_t count = std::min(BatchSize, values.size() - i);
+      trace.appendRuns(start, &values[i], &runLengths[i], count);
+      Time cycles = std::accumulate(&runLengths[i], &runLengths[i] + count,
+                                    Time(0));
+      start = DeltaTime(start.simcycle() + cycles, 0);
+    }
+    processed += values.size();
+    benchmark::DoNotOptimize(trace);
+  }
+  state.SetItemsProcessed(processed);
+}
+
 static void BM_construct_trace(benchmark::State &state) {
   while (state.KeepRunning()) {
     Trace trace(0);
@@ -31,6 +112,30 @@ static void BM_construct_trace(benchmark::State &state) {
   }
 }
 
+// range_x traces of a few changes each, like most signals of a design
+static void BM_small_traces(benchmark::State &state) {
+  std::vector<Trace *> traces(state.range_x());
+  std::size_t bytes = 0;
+  while (state.KeepRunning()) {
+    for (std::size_t i = 0; i < traces.size(); ++i) {
+      traces[i] = new Trace(0);
+      for (Time t = 1; t <= 4; ++t) {
+        traces[i]->appendMonotonic(t % 2, DeltaTime(t, 0));
+      }
+    }
+    state.PauseTiming();
+    bytes = traces[0]->memoryUsage().bytes();
+    for (std::size_t i = 0; i < traces.size(); ++i) {
+      delete traces[i];
+    }
+    state.ResumeTiming();
+  }
+  std::ostringstream label;
+  label << bytes << " bytes per trace";
+  state.SetLabel(label.str());
+  state.SetItemsProcessed(state.iterations() * traces.size());
+}
+
 static void BM_increment(benchmark::State &state) {
   DeltaTime time(0, 0);
   while (state.KeepRunning()) {
@@ -39,8 +144,45 @@ static void BM_increment(benchmark::State &state) {
   benchmark::DoNotOptimize(time);
 }
 
+static void BM_compare(benchmark::State &state) {
+  DeltaTime a(0, 0);
+  DeltaTime b(0, 3);
+  std::size_t less = 0;
+  while (state.KeepRunning()) {
+    ++a;
+    benchmark::DoNotOptimize(a);
+    less += (a < b) + (a <= b) + (a == b);
+  }
+  benchmark::DoNotOptimize(less);
+}
+
+static void BM_hash(benchmark::State &state) {
+  DeltaTime time(0, 0);
+  std::hash<DeltaTime> hasher;
+  std::size_t h = 0;
+  while (state.KeepRunning()) {
+    ++time;
+    h ^= hasher(time);
+  }
+  benchmark::DoNotOptimize(h);
+}
+
+static void BM_rebase(benchmark::State &state) {
+  DeltaTime time(1000, 3);
+  DeltaTime oldBase(10, 4);
+  DeltaTime newBase(20, 2);
+  while (state.KeepRunning()) {
+    time = time.rebase(oldBase, newBase);
+    benchmark::DoNotOptimize(time);
+  }
+}
+
 BENCHMARK(BM_construct_trace);
+BENCHMARK(BM_small_traces)->Arg(100000);
 BENCHMARK(BM_increment);
+BENCHMARK(BM_compare);
+BENCHMARK(BM_hash);
+BENCHMARK(BM_rebase);
 BENCHMARK(BM_append)
     ->Arg(8)
     ->Arg(64)
@@ -51,4 +193,25 @@ BENCHMARK(BM_append)
     ->Arg(1 << 21)
     ->Arg(1 << 22);
 
+BENCHMARK(BM_append_monotonic)
+    ->Arg(8)
+    ->Arg(64)
+    ->Arg(512)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(1 << 21)
+    ->Arg(1 << 22);
+
+BENCHMARK(BM_append_batch)
+    ->Arg(8)
+    ->Arg(64)
+    ->Arg(512)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(1 << 21)
+    ->Arg(1 << 22);
+BENCHMARK(BM_append_runs)->Arg(1 << 10)->Arg(1 << 20)->Arg(1 << 22);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,109 @@
+#include <trace/Trace.h>
+#include <trace/TraceArchive.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::TraceArchive;
+using svt::TraceArchiveWriter;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+const char *const FileName = "benchmark_archive.sva";
+
+// count Traces with length changes each, every one with its own period
+class Traces {
+public:
+  Traces(std::size_t count, std::size_t length) {
+    for (std::size_t i = 0; i < count; ++i) {
+      _traces.push_back(new Trace(0));
+      Time period = 1 + i % 7;
+      for (std::size_t j = 0; j < length; ++j) {
+        _traces.back()->appendMonotonic((i + j) % 2, DeltaTime(j * period, 0));
+      }
+    }
+  }
+  ~Traces() {
+    for (std::size_t i = 0; i < _traces.size(); ++i) {
+      delete _traces[i];
+    }
+  }
+
+  void write(Time blockCycles, unsigned numThreads) const {
+    TraceArchiveWriter writer(FileName, blockCycles, numThreads);
+    for (std::size_t i = 0; i < _traces.size(); ++i) {
+      std::ostringstream name;
+      name << "top.signal" << i;
+      writer.addSignal(name.str(), *_traces[i]);
+    }
+    writer.write();
+  }
+
+private:
+  std::vector<Trace *> _traces;
+};
+
+std::size_t file_size() {
+  std::ifstream in(FileName, std::ios::binary | std::ios::ate);
+  return in.tellg();
+}
+}
+
+// 1024 Traces with 1 << 14 changes each written by range_x threads, the
+// bytes are those of the checkpoints (time and value)
+static void BM_write_archive(benchmark::State &state) {
+  const std::size_t count = 1024;
+  const std::size_t length = 1 << 14;
+  Traces traces(count, length);
+
+  while (state.KeepRunning()) {
+    traces.write(1 << 12, state.range_x());
+  }
+
+  const std::size_t bytes = count * length * (sizeof(DeltaTime) + sizeof(Bit));
+  std::ostringstream label;
+  label << "compression " << double(bytes) / file_size();
+  state.SetLabel(label.str());
+  state.SetBytesProcessed(state.iterations() * bytes);
+  std::remove(FileName);
+}
+
+BENCHMARK(BM_write_archive)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// a window of 1 << 12 simcycles of 100 out of range_x signals
+static void BM_read_window(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  Traces(count, 1 << 8).write(1 << 10, 0);
+  TraceArchive archive(FileName);
+
+  std::vector<std::size_t> signals;
+  for (std::size_t i = 0; i < 100; ++i) {
+    signals.push_back(i * (count / 100));
+  }
+  std::size_t checkpoints = 0;
+  while (state.KeepRunning()) {
+    std::vector<Trace *> traces;
+    for (std::size_t i = 0; i < signals.size(); ++i) {
+      traces.push_back(new Trace(0));
+    }
+    archive.read(signals, 1 << 9, (1 << 9) + (1 << 12), traces);
+    for (std::size_t i = 0; i < traces.size(); ++i) {
+      checkpoints += traces[i]->numberOfCheckpoints();
+      delete traces[i];
+    }
+  }
+  benchmark::DoNotOptimize(checkpoints);
+  state.SetItemsProcessed(state.iterations() * signals.size());
+  std::remove(FileName);
+}
+
+BENCHMARK(BM_read_window)->Arg(1000)->Arg(100000);
+
+BENCHMARK_MAIN();
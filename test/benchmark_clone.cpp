@@ -0,0 +1,98 @@
+#include <trace/Trace.h>
+#include <trace/TraceFramePool.h>
+
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::TracePtr;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+// a trace with one change every 1-3 simcycles
+void fill_trace(Trace &trace, std::size_t length) {
+  std::vector<DeltaTime> times(length);
+  std::vector<Bit> values(length);
+  Time cycle = 0;
+  for (size_t i = 0; i < length; ++i) {
+    cycle += 1 + i % 3;
+    times[i] = DeltaTime(cycle, i % 4);
+    values[i] = i % 2;
+  }
+  trace.appendBatch(&times[0], &values[0], length);
+}
+}
+
+// clone and release a trace of range_x checkpoints
+static void BM_clone(benchmark::State &state) {
+  Trace trace(0);
+  fill_trace(trace, state.range_x());
+
+  while (state.KeepRunning()) {
+    TracePtr clone = trace.clone();
+    benchmark::DoNotOptimize(clone.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// the same up to the middle of the trace
+static void BM_clone_upper_bound(benchmark::State &state) {
+  Trace trace(0);
+  fill_trace(trace, state.range_x());
+  DeltaTime middle(trace.lastCheckpoint().simcycle() / 2, 1);
+
+  while (state.KeepRunning()) {
+    TracePtr clone = trace.clone(middle);
+    benchmark::DoNotOptimize(clone.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// 64 snapshots of a trace of range_x checkpoints, each followed by 8 writes
+// at random times. Reports the memory of all snapshots relative to the
+// memory of the trace alone.
+static void BM_snapshot_edits(benchmark::State &state) {
+  const std::size_t Snapshots = 64;
+  const std::size_t Edits = 8;
+
+  std::size_t bytes = 0;
+  std::size_t singleBytes = 0;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    TracePtr trace(new Trace(0));
+    fill_trace(*trace, state.range_x());
+    singleBytes = trace->framePool()->statistics().bytes;
+    Time cycles = trace->lastCheckpoint().simcycle();
+    Time random = 12345;
+    std::vector<TracePtr> snapshots;
+    state.ResumeTiming();
+
+    for (std::size_t i = 0; i < Snapshots; ++i) {
+      snapshots.push_back(trace->clone());
+      for (std::size_t j = 0; j < Edits; ++j) {
+        random = random * 6364136223846793005ull + 1442695040888963407ull;
+        trace->set((random >> 8) & 1, DeltaTime((random >> 16) % cycles, 0));
+      }
+    }
+
+    state.PauseTiming();
+    bytes = trace->framePool()->statistics().bytes;
+    snapshots.clear();
+    trace.reset();
+    state.ResumeTiming();
+  }
+  std::ostringstream label;
+  label << "memory x " << double(bytes) / singleBytes;
+  state.SetLabel(label.str());
+  state.SetItemsProcessed(state.iterations() * Snapshots);
+}
+
+BENCHMARK(BM_clone)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK(BM_clone_upper_bound)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK(BM_snapshot_edits)->Arg(1 << 10)->Arg(1 << 20);
+
+BENCHMARK_MAIN();
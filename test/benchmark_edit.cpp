@@ -0,0 +1,120 @@
+#include <trace/Trace.h>
+
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+// the entries of a general trace with a change at every odd simcycle
+class Changes {
+public:
+  explicit Changes(std::size_t length) : _times(length), _values(length) {
+    for (std::size_t i = 0; i < length; ++i) {
+      _times[i] = DeltaTime(2 * i + 1, 0);
+      _values[i] = i % 3;
+    }
+  }
+
+  void fill(Trace &trace) const {
+    trace.clear();
+    trace.appendBatch(&_times[0], &_values[0], _times.size());
+  }
+
+private:
+  std::vector<DeltaTime> _times;
+  std::vector<Bit> _values;
+};
+}
+
+// set the middle range_x checkpoints of a trace of 2 * range_x checkpoints
+// to a single value
+static void BM_set_range(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  Changes changes(2 * count);
+  Trace trace(0);
+  DeltaTime begin(count, 0);
+  DeltaTime end(3 * count, 0);
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    changes.fill(trace);
+    state.ResumeTiming();
+    trace.setRange(3, begin, end);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+// remove them, with shift the later checkpoints move to begin
+static void BM_remove_range(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  const bool shift = state.range_y();
+  Changes changes(2 * count);
+  Trace trace(0);
+  DeltaTime begin(count, 0);
+  DeltaTime end(3 * count, 0);
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    changes.fill(trace);
+    state.ResumeTiming();
+    trace.removeRange(begin, end, shift);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+// set a new value at random times in the middle of simcycles of a trace of
+// range_x checkpoints, each set inserts a checkpoint into the frames
+static void BM_insert_random(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  Changes changes(count);
+  Trace trace(0);
+  changes.fill(trace);
+  Time random = 12345;
+
+  while (state.KeepRunning()) {
+    random = random * 6364136223846793005ull + 1442695040888963407ull;
+    trace.set(3, DeltaTime((random >> 16) % (2 * count), 1));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// repack a trace of range_x checkpoints after an insert into the middle of
+// every frame split all of them
+static void BM_repack(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  Changes changes(count);
+  Trace trace(0);
+  double fill = 0;
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    changes.fill(trace);
+    for (std::size_t i = 0; i < count; i += Trace::Frame::max_size) {
+      trace.set(3, DeltaTime(2 * i + Trace::Frame::max_size, 1));
+    }
+    fill = trace.memoryUsage().fill();
+    state.ResumeTiming();
+    trace.repack();
+  }
+  std::ostringstream label;
+  label << "fill " << fill << " -> " << trace.memoryUsage().fill();
+  state.SetLabel(label.str());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(BM_set_range)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK(BM_remove_range)
+    ->ArgPair(1 << 10, false)
+    ->ArgPair(1 << 20, false)
+    ->ArgPair(1 << 10, true)
+    ->ArgPair(1 << 20, true);
+BENCHMARK(BM_insert_random)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 23);
+BENCHMARK(BM_repack)->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,115 @@
+#include <trace/Trace.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using svt::BasicTrace;
+using svt::DeltaTime;
+using svt::Time;
+
+// Compares the frame sizes BasicTrace is instantiated for. Every benchmark
+// runs on a short and on a long trace.
+
+namespace {
+
+// one change every 2 simcycles, the odd cycles are free for inserts
+template <unsigned FrameSize>
+void fill_trace(BasicTrace<FrameSize> &trace, std::size_t length) {
+  std::vector<DeltaTime> times(length);
+  std::vector<Bit> values(length);
+  for (size_t i = 0; i < length; ++i) {
+    times[i] = DeltaTime(2 * i, 0);
+    values[i] = i % 2;
+  }
+  trace.appendBatch(&times[0], &values[0], length);
+}
+
+// linear congruential generator, cheap enough not to dominate the lookup
+struct RandomCycles {
+  RandomCycles(Time maxCycle) : _state(12345), _maxCycle(maxCycle) {}
+
+  Time next() {
+    _state = _state * 6364136223846793005ull + 1442695040888963407ull;
+    return (_state >> 16) % _maxCycle;
+  }
+
+  Time _state;
+  Time _maxCycle;
+};
+}
+
+template <unsigned FrameSize>
+static void BM_append_frame_size(benchmark::State &state) {
+  const std::size_t length = state.range_x();
+  while (state.KeepRunning()) {
+    BasicTrace<FrameSize> trace(0);
+    for (size_t i = 0; i < length; ++i) {
+      trace.appendMonotonic(i % 2, DeltaTime(i, 0));
+    }
+    benchmark::DoNotOptimize(trace.numberOfCheckpoints());
+  }
+  state.SetItemsProcessed(state.iterations() * length);
+}
+
+template <unsigned FrameSize>
+static void BM_get_frame_size(benchmark::State &state) {
+  BasicTrace<FrameSize> trace(0);
+  fill_trace(trace, state.range_x());
+  RandomCycles random(2 * state.range_x());
+
+  Bit sum = 0;
+  while (state.KeepRunning()) {
+    sum += trace.get(DeltaTime(random.next(), 0));
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// insert a checkpoint between two existing ones and merge it away again,
+// the trace keeps its length but the frames are split over time
+template <unsigned FrameSize>
+static void BM_insert_frame_size(benchmark::State &state) {
+  BasicTrace<FrameSize> trace(0);
+  fill_trace(trace, state.range_x());
+  RandomCycles random(state.range_x() - 1);
+
+  while (state.KeepRunning()) {
+    Time cycle = 2 * random.next();
+    trace.set(2, DeltaTime(cycle + 1, 0));
+    trace.set((cycle / 2) % 2, DeltaTime(cycle + 1, 0));
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+}
+
+template <unsigned FrameSize>
+static void BM_iterate_frame_size(benchmark::State &state) {
+  BasicTrace<FrameSize> trace(0);
+  fill_trace(trace, state.range_x());
+
+  typedef typename BasicTrace<FrameSize>::const_iterator Iterator;
+  Time sum = 0;
+  while (state.KeepRunning()) {
+    for (Iterator it = trace.begin(), end = trace.end(); it != end; ++it) {
+      sum += it.value();
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+#define BENCHMARK_FRAME_SIZES(bm)                                              \
+  BENCHMARK_TEMPLATE(bm, 16)->Arg(1 << 10)->Arg(1 << 20);                      \
+  BENCHMARK_TEMPLATE(bm, 32)->Arg(1 << 10)->Arg(1 << 20);                      \
+  BENCHMARK_TEMPLATE(bm, 64)->Arg(1 << 10)->Arg(1 << 20);                      \
+  BENCHMARK_TEMPLATE(bm, 128)->Arg(1 << 10)->Arg(1 << 20);                     \
+  BENCHMARK_TEMPLATE(bm, 256)->Arg(1 << 10)->Arg(1 << 20);                     \
+  BENCHMARK_TEMPLATE(bm, 512)->Arg(1 << 10)->Arg(1 << 20);                     \
+  BENCHMARK_TEMPLATE(bm, 1024)->Arg(1 << 10)->Arg(1 << 20)
+
+BENCHMARK_FRAME_SIZES(BM_append_frame_size);
+BENCHMARK_FRAME_SIZES(BM_get_frame_size);
+BENCHMARK_FRAME_SIZES(BM_insert_frame_size);
+BENCHMARK_FRAME_SIZES(BM_iterate_frame_size);
+
+BENCHMARK_MAIN();
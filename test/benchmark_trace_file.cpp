@@ -0,0 +1,128 @@
+#include <trace/Trace.h>
+#include <trace/TraceFile.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <vector>
+
+using svt::Trace;
+using svt::TraceFile;
+using svt::TraceFileWriter;
+using svt::TraceView;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+const char *const FileName = "benchmark_trace_file.svt";
+
+// a trace with one change every 1-3 simcycles
+void fill_trace(Trace &trace, std::size_t length) {
+  std::vector<DeltaTime> times(length);
+  std::vector<Bit> values(length);
+  Time cycle = 0;
+  for (size_t i = 0; i < length; ++i) {
+    cycle += 1 + i % 3;
+    times[i] = DeltaTime(cycle, i % 4);
+    values[i] = i % 2;
+  }
+  trace.appendBatch(&times[0], &values[0], length);
+}
+
+// numTraces Traces of length checkpoints each
+void write_file(std::size_t numTraces, std::size_t length) {
+  Trace trace(0);
+  fill_trace(trace, length);
+  TraceFileWriter writer(FileName);
+  for (std::size_t i = 0; i < numTraces; ++i) {
+    writer.add(trace);
+  }
+  writer.close();
+}
+
+// linear congruential generator, cheap enough not to dominate the lookup
+struct RandomTimes {
+  RandomTimes(Time maxCycle) : _state(12345), _maxCycle(maxCycle) {}
+
+  DeltaTime next() {
+    _state = _state * 6364136223846793005ull + 1442695040888963407ull;
+    return DeltaTime((_state >> 16) % _maxCycle, (_state >> 8) & 3);
+  }
+
+  Time _state;
+  Time _maxCycle;
+};
+}
+
+// startup with a file of range_x Traces: mapping it versus building the
+// Traces from its contents
+static void BM_open_trace_file(benchmark::State &state) {
+  write_file(state.range_x(), 1 << 10);
+
+  std::size_t checkpoints = 0;
+  while (state.KeepRunning()) {
+    TraceFile file(FileName);
+    for (std::size_t i = 0; i < file.size(); ++i) {
+      checkpoints += file.view(i).numberOfCheckpoints();
+    }
+  }
+  benchmark::DoNotOptimize(checkpoints);
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+  std::remove(FileName);
+}
+
+static void BM_load_traces(benchmark::State &state) {
+  write_file(state.range_x(), 1 << 10);
+
+  std::vector<DeltaTime> times;
+  std::vector<Bit> values;
+  while (state.KeepRunning()) {
+    TraceFile file(FileName);
+    std::vector<Trace *> traces;
+    for (std::size_t i = 0; i < file.size(); ++i) {
+      TraceView view = file.view(i);
+      times.clear();
+      values.clear();
+      for (TraceView::const_iterator it = view.begin(); it != view.end();
+           ++it) {
+        times.push_back(it.time());
+        values.push_back(it.value());
+      }
+      traces.push_back(new Trace(view.getInitvalue()));
+      traces.back()->appendBatch(&times[0], &values[0], times.size());
+    }
+    for (std::size_t i = 0; i < traces.size(); ++i) {
+      delete traces[i];
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+  std::remove(FileName);
+}
+
+BENCHMARK(BM_open_trace_file)->Arg(1 << 8)->Arg(1 << 12);
+BENCHMARK(BM_load_traces)->Arg(1 << 8)->Arg(1 << 12);
+
+// compare with BM_get_random of benchmark_access
+static void BM_get_random_view(benchmark::State &state) {
+  write_file(1, state.range_x());
+  TraceFile file(FileName);
+  TraceView view = file.view(0);
+  RandomTimes random(view.lastCheckpoint().simcycle());
+
+  Bit sum = 0;
+  while (state.KeepRunning()) {
+    sum += view.get(random.next());
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+  std::remove(FileName);
+}
+
+BENCHMARK(BM_get_random_view)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Arg(1 << 20)
+    ->Arg(10000000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,97 @@
+#include <trace/Trace.h>
+#include <trace/TraceMerge.h>
+
+#include <benchmark/benchmark.h>
+
+#include <boost/optional.hpp>
+
+#include <vector>
+
+using svt::Trace;
+using svt::TraceEvent;
+using svt::TraceMerge;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+// count Traces with 64 changes after simcycle 0 each, every one with its
+// own period
+class Traces {
+public:
+  explicit Traces(std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      _traces.push_back(new Trace(0));
+      Time period = 1 + i % 97;
+      for (std::size_t j = 0; j < 64; ++j) {
+        _traces.back()->appendMonotonic((i + j) % 2,
+                                        DeltaTime(1 + i % 13 + j * period, 0));
+      }
+    }
+  }
+  ~Traces() {
+    for (std::size_t i = 0; i < _traces.size(); ++i) {
+      delete _traces[i];
+    }
+  }
+
+  std::size_t size() const { return _traces.size(); }
+  Trace const &operator[](std::size_t i) const { return *_traces[i]; }
+
+private:
+  std::vector<Trace *> _traces;
+};
+}
+
+// all events of range_x signals in time order, read in batches of 1024
+static void BM_merge_events(benchmark::State &state) {
+  Traces traces(state.range_x());
+  TraceMerge merge;
+  for (std::size_t i = 0; i < traces.size(); ++i) {
+    merge.add(traces[i]);
+  }
+  std::vector<TraceEvent> events(1024);
+
+  std::size_t count = 0;
+  while (state.KeepRunning()) {
+    merge.seek(DeltaTime(0, 0));
+    while (std::size_t n = merge.read(events.data(), events.size())) {
+      count += n;
+    }
+  }
+  state.SetItemsProcessed(count);
+}
+
+// the same by asking every signal for its next checkpoint after each time
+// with a change
+static void BM_next_checkpoint_loop(benchmark::State &state) {
+  Traces traces(state.range_x());
+  std::vector<boost::optional<DeltaTime> > next(traces.size());
+
+  std::size_t count = 0;
+  while (state.KeepRunning()) {
+    DeltaTime time(0, 0);
+    for (;;) {
+      boost::optional<DeltaTime> first;
+      for (std::size_t i = 0; i < traces.size(); ++i) {
+        next[i] = traces[i].nextCheckpoint(time);
+        if (next[i] && (!first || *next[i] < *first)) {
+          first = next[i];
+        }
+      }
+      if (!first) {
+        break;
+      }
+      for (std::size_t i = 0; i < traces.size(); ++i) {
+        count += next[i] == first;
+      }
+      time = *first;
+    }
+  }
+  state.SetItemsProcessed(count);
+}
+
+BENCHMARK(BM_merge_events)->Arg(1 << 10)->Arg(100000);
+BENCHMARK(BM_next_checkpoint_loop)->Arg(1 << 10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+#include <trace/Trace.h>
+#include <trace/TraceSet.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <vector>
+
+using svt::Trace;
+using svt::TraceSet;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+const Time Length = 1 << 16;
+
+// count signals until Length, the period of a signal is a random power of
+// two from 1 to 4096 simcycles
+void fill(TraceSet &set, std::size_t count) {
+  std::srand(1);
+  for (std::size_t i = 0; i < count; ++i) {
+    set.add(0);
+  }
+  std::vector<Time> next(count, 0);
+  for (Time t = 0; t < Length; ++t) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (next[i] == t) {
+        set.append(i, std::rand() % 2, DeltaTime(t, 0));
+        next[i] += Time(1) << std::rand() % 13;
+      }
+    }
+  }
+}
+
+std::vector<DeltaTime> random_times(std::size_t count) {
+  std::vector<DeltaTime> times;
+  for (std::size_t i = 0; i < count; ++i) {
+    times.push_back(DeltaTime(std::rand() % Length, 0));
+  }
+  return times;
+}
+}
+
+// the values of range_x signals at random times, one Trace after the other
+static void BM_get_all_signals(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  TraceSet set;
+  fill(set, count);
+  std::vector<DeltaTime> times = random_times(1 << 10);
+  std::vector<Bit> values(count);
+
+  std::size_t n = 0;
+  while (state.KeepRunning()) {
+    DeltaTime t = times[n++ % times.size()];
+    for (std::size_t i = 0; i < count; ++i) {
+      values[i] = set[i].get(t);
+    }
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+// the same through the time index of the set
+static void BM_values_at(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  TraceSet set;
+  fill(set, count);
+  std::vector<DeltaTime> times = random_times(1 << 10);
+  std::vector<Bit> values(count);
+  // build the whole index
+  set.valuesAt(DeltaTime(Length, 0), values.data());
+
+  std::size_t n = 0;
+  while (state.KeepRunning()) {
+    set.valuesAt(times[n++ % times.size()], values.data());
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+// 64 snapshots of all signals at once
+static void BM_snapshots(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  TraceSet set;
+  fill(set, count);
+  std::vector<DeltaTime> times = random_times(64);
+  set.valuesAt(DeltaTime(Length, 0));
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(set.snapshots(times).data());
+  }
+  state.SetItemsProcessed(state.iterations() * count * times.size());
+}
+
+BENCHMARK(BM_get_all_signals)->Arg(1 << 10)->Arg(50000);
+BENCHMARK(BM_values_at)->Arg(1 << 10)->Arg(50000);
+BENCHMARK(BM_snapshots)->Arg(1 << 10)->Arg(50000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+#include <trace/Trace.h>
+#include <trace/TraceStore.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::TracePtr;
+using svt::TraceStore;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+const std::size_t Waveforms = 64;
+const std::size_t Checkpoints = 1 << 10;
+
+// a new Trace with waveform number waveform, a clock of the period
+// 2 + waveform % 16 with a random glitch
+TracePtr make_trace(std::size_t waveform) {
+  std::srand(waveform);
+  TracePtr trace(new Trace(0));
+  const Time period = 2 + waveform % 16;
+  for (std::size_t i = 0; i < Checkpoints; ++i) {
+    trace->appendMonotonic(i % 2, DeltaTime(i * period + 1, 0));
+  }
+  trace->set(2, DeltaTime(std::rand() % (Checkpoints * period), 1));
+  return trace;
+}
+
+// range_x signals, every one with one of Waveforms waveforms
+void fill(TraceStore &store, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    store.add(make_trace(i % Waveforms));
+  }
+}
+}
+
+// add range_x signals, each in a Trace of its own
+static void BM_store_add(benchmark::State &state) {
+  const std::size_t count = state.range_x();
+  std::size_t bytes = 0;
+  std::size_t storedBytes = 0;
+  while (state.KeepRunning()) {
+    TraceStore store;
+    fill(store, count);
+    state.PauseTiming();
+    bytes = 0;
+    storedBytes = 0;
+    for (std::size_t i = 0; i < store.size(); ++i) {
+      const std::size_t traceBytes = store[i].memoryUsage().bytes();
+      bytes += traceBytes;
+      storedBytes += i < Waveforms ? traceBytes : 0;
+    }
+    state.ResumeTiming();
+  }
+  std::ostringstream label;
+  label << bytes / 1024 << " KiB in " << storedBytes / 1024 << " KiB";
+  state.SetLabel(label.str());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+// compare pairs of signals, with the store and by their checkpoints
+static void BM_store_same(benchmark::State &state) {
+  const bool byStore = state.range_x();
+  TraceStore store;
+  fill(store, 4 * Waveforms);
+
+  std::size_t n = 0;
+  std::size_t equal = 0;
+  while (state.KeepRunning()) {
+    const std::size_t a = n++ % store.size();
+    const std::size_t b = (a + Waveforms) % store.size();
+    equal += byStore ? store.same(a, b) : store[a] == store[b];
+  }
+  benchmark::DoNotOptimize(equal);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// write a checkpoint of a shared signal, look it up again and undo it
+static void BM_store_modify(benchmark::State &state) {
+  TraceStore store;
+  fill(store, 4 * Waveforms);
+
+  std::size_t n = 0;
+  while (state.KeepRunning()) {
+    const std::size_t signal = n++ % store.size();
+    Trace &trace = store.modify(signal);
+    const DeltaTime time(trace.lastCheckpoint().simcycle() / 2, 1);
+    const Bit old = trace.get(time);
+    trace.set(3, time);
+    store.dedup();
+    store.modify(signal).set(old, time);
+    store.dedup();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_store_add)->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(BM_store_same)->Arg(false)->Arg(true);
+BENCHMARK(BM_store_modify);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,85 @@
+#include <trace/Trace.h>
+#include <trace/Vcd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::VcdReader;
+using svt::VcdWriter;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+// range_x Traces with 1 << 14 changes each, every one with its own period
+class Traces {
+public:
+  explicit Traces(std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      _traces.push_back(new Trace(0));
+      Time period = 1 + i % 7;
+      for (std::size_t j = 0; j < (1 << 14); ++j) {
+        _traces.back()->appendMonotonic((i + j) % 2, DeltaTime(j * period, 0));
+      }
+    }
+  }
+  ~Traces() {
+    for (std::size_t i = 0; i < _traces.size(); ++i) {
+      delete _traces[i];
+    }
+  }
+
+  void write(std::ostream &out) const {
+    VcdWriter writer(out);
+    for (std::size_t i = 0; i < _traces.size(); ++i) {
+      std::ostringstream name;
+      name << "top.signal" << i;
+      writer.addSignal(name.str(), *_traces[i]);
+    }
+    writer.write();
+  }
+
+private:
+  std::vector<Trace *> _traces;
+};
+}
+
+static void BM_write_vcd(benchmark::State &state) {
+  Traces traces(state.range_x());
+  std::size_t bytes = 0;
+
+  while (state.KeepRunning()) {
+    std::ostringstream out;
+    traces.write(out);
+    bytes += out.tellp();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+static void BM_read_vcd(benchmark::State &state) {
+  std::ostringstream out;
+  Traces(state.range_x()).write(out);
+  std::string const vcd = out.str();
+
+  while (state.KeepRunning()) {
+    std::istringstream in(vcd);
+    VcdReader reader(in);
+    std::vector<Trace *> traces;
+    for (std::size_t i = 0; i < reader.signals().size(); ++i) {
+      traces.push_back(new Trace(0));
+    }
+    reader.read(traces);
+    for (std::size_t i = 0; i < traces.size(); ++i) {
+      delete traces[i];
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * vcd.size());
+}
+
+BENCHMARK(BM_write_vcd)->Arg(16)->Arg(256);
+BENCHMARK(BM_read_vcd)->Arg(16)->Arg(256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,159 @@
+#include <trace/Trace.h>
+#include <trace/TraceFramePool.h>
+#include <trace/VersionedTrace.h>
+
+#include <benchmark/benchmark.h>
+
+#include <deque>
+#include <sstream>
+#include <vector>
+
+using svt::Trace;
+using svt::TracePtr;
+using svt::VersionedTrace;
+using svt::DeltaTime;
+using svt::Time;
+
+namespace {
+
+// number of versions kept by the benchmarks
+const std::size_t History = 1024;
+
+// a general trace with one change every 1-3 simcycles
+void fill_trace(Trace &trace, std::size_t length) {
+  std::vector<DeltaTime> times(length);
+  std::vector<Bit> values(length);
+  Time cycle = 0;
+  for (size_t i = 0; i < length; ++i) {
+    cycle += 1 + i % 3;
+    times[i] = DeltaTime(cycle, 0);
+    values[i] = i % 3;
+  }
+  trace.appendBatch(&times[0], &values[0], length);
+}
+
+// linear congruential generator, cheap enough not to dominate the edit
+struct RandomTimes {
+  RandomTimes(Time maxCycle) : _state(12345), _maxCycle(maxCycle) {}
+
+  DeltaTime next() {
+    _state = _state * 6364136223846793005ull + 1442695040888963407ull;
+    return DeltaTime((_state >> 16) % _maxCycle, 0);
+  }
+
+  Time _state;
+  Time _maxCycle;
+};
+
+std::string bytes_per_version(std::size_t bytes) {
+  std::ostringstream label;
+  label << "frame bytes/version " << bytes / History;
+  return label.str();
+}
+}
+
+// set at random times on a trace of range_x checkpoints, keeping the last
+// History versions
+static void BM_versioned_set(benchmark::State &state) {
+  TracePtr trace(new Trace(0));
+  fill_trace(*trace, state.range_x());
+  VersionedTrace versions(trace);
+  RandomTimes random(trace->lastCheckpoint().simcycle());
+
+  std::size_t bytes = trace->framePool()->statistics().bytes;
+  for (std::size_t i = 0; i < History; ++i) {
+    versions.set(i % 3, random.next());
+  }
+  state.SetLabel(
+      bytes_per_version(trace->framePool()->statistics().bytes - bytes));
+
+  Bit value = 0;
+  while (state.KeepRunning()) {
+    versions.set(value, random.next());
+    value = (value + 1) % 3;
+    versions.forget(versions.version() - History);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// the same with a clone of the trace before every set, History clones of
+// a million checkpoints do not fit into memory
+static void BM_clone_set(benchmark::State &state) {
+  TracePtr trace(new Trace(0));
+  fill_trace(*trace, state.range_x());
+  std::deque<TracePtr> clones;
+  RandomTimes random(trace->lastCheckpoint().simcycle());
+
+  std::size_t bytes = trace->framePool()->statistics().bytes;
+  for (std::size_t i = 0; i < History; ++i) {
+    clones.push_back(trace->clone());
+    trace->set(i % 3, random.next());
+  }
+  state.SetLabel(
+      bytes_per_version(trace->framePool()->statistics().bytes - bytes));
+
+  Bit value = 0;
+  while (state.KeepRunning()) {
+    clones.push_back(trace->clone());
+    trace->set(value, random.next());
+    value = (value + 1) % 3;
+    clones.pop_front();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// undo and redo History sets on a trace of range_x checkpoints
+static void BM_undo_redo(benchmark::State &state) {
+  TracePtr trace(new Trace(0));
+  fill_trace(*trace, state.range_x());
+  VersionedTrace versions(trace);
+  RandomTimes random(trace->lastCheckpoint().simcycle());
+  for (std::size_t i = 0; i < History; ++i) {
+    versions.set(i % 3, random.next());
+  }
+
+  while (state.KeepRunning()) {
+    versions.revert(versions.oldest());
+    versions.revert(versions.newest());
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * History);
+}
+
+// set, undo and redo on a sparse trace of range_x checkpoints with a
+// repack threshold, which the versioned trace must not trigger
+static void BM_versioned_repack(benchmark::State &state) {
+  TracePtr trace(new Trace(0));
+  fill_trace(*trace, state.range_x());
+  const Time lastCycle = trace->lastCheckpoint().simcycle();
+  for (Time cycle = 0; cycle < lastCycle; cycle += 128) {
+    trace->removeRange(DeltaTime(cycle, 0), DeltaTime(cycle + 64, 0));
+  }
+  Trace expected(0);
+  fill_trace(expected, state.range_x());
+  for (Time cycle = 0; cycle < lastCycle; cycle += 128) {
+    expected.removeRange(DeltaTime(cycle, 0), DeltaTime(cycle + 64, 0));
+  }
+  trace->setRepackThreshold(0.9);
+  VersionedTrace versions(trace);
+  RandomTimes random(lastCycle);
+
+  Bit value = 0;
+  while (state.KeepRunning()) {
+    const DeltaTime time = random.next();
+    versions.set(value, time);
+    expected.set(value, time);
+    value = (value + 1) % 3;
+    versions.undo();
+    versions.redo();
+    versions.forget(versions.version());
+  }
+  state.SetLabel(versions.trace() == expected ? "" : "wrong result");
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_versioned_set)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(BM_clone_set)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_undo_redo)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK(BM_versioned_repack)->Arg(1 << 10);
+
+BENCHMARK_MAIN();
@@ -1,31 +1,27 @@
 #include "DeltaTime.h"
 
 #include <boost/static_assert.hpp>
-#include <boost/math/special_functions/pow.hpp>
+
+#include <iostream>
 
 using namespace svt;
 
 BOOST_STATIC_ASSERT(sizeof(Time) == 8);
 BOOST_STATIC_ASSERT(DELTACYCLE_BITWIDTH + SIMCYCLE_BITWIDTH == 64);
+BOOST_STATIC_ASSERT(sizeof(DeltaTime) == sizeof(PackedDeltaTime));
 
-const Time DeltaTime::MaxDeltaTime = 255ull;
-const Time DeltaTime::MaxSimTime = 72057594037927935ull;
+constexpr Time DeltaTime::MaxDeltaTime;
+constexpr Time DeltaTime::MaxSimTime;
 const DeltaTime DeltaTime::initTime = DeltaTime(MaxSimTime, MaxDeltaTime);
 
 DeltaTime DeltaTime::operator+(Time simcycle) const {
-  assert(_data._simcycle < MaxSimTime);
-  return endOfCycle(_data._simcycle + simcycle);
-}
-
-DeltaTime &DeltaTime::operator++() {
-  assert(_data._simcycle < MaxSimTime);
-  ++_data._simcycle; // may be overlapped on 2^54 bits
-  return *this;
+  assert(this->simcycle() < MaxSimTime);
+  return endOfCycle(this->simcycle() + simcycle);
 }
 
 DeltaTime DeltaTime::operator-(Time simcycle) const {
-  assert(_data._simcycle > 0);
-  return endOfCycle(_data._simcycle - simcycle);
+  assert(this->simcycle() > 0);
+  return endOfCycle(this->simcycle() - simcycle);
 }
 
 DeltaTime DeltaTime::rebase(DeltaTime const &oldBase,
@@ -34,36 +30,17 @@ DeltaTime DeltaTime::rebase(DeltaTime const &oldBase,
     return *this;
   }
 
-  Time positiveSide = _data._simcycle + newBase._data._simcycle;
-
-  if (positiveSide < oldBase._data._simcycle) {
-    // underflow
-    return DeltaTime(0, 0);
+  if (oldBase < newBase) {
+    // wraps around on overflow of the simcycle
+    return fromPacked(_ordinal + (newBase._ordinal - oldBase._ordinal));
   }
 
-  Time positiveDelta = _data._deltacycle + newBase._data._deltacycle;
-
-  if (positiveSide == oldBase._data._simcycle &&
-      positiveDelta < oldBase._data._deltacycle) {
+  PackedDeltaTime shift = oldBase._ordinal - newBase._ordinal;
+  if (_ordinal < shift) {
     // underflow
     return DeltaTime(0, 0);
   }
-
-  Time cycle = positiveSide - oldBase._data._simcycle;
-  Time delta = positiveDelta - oldBase._data._deltacycle;
-
-  if (isEndOfCycle()) {
-    if (oldBase._data._deltacycle < newBase._data._deltacycle) {
-      // delta overflow
-      if (cycle == MaxSimTime) {
-        cycle = 0;
-      } else {
-        cycle += 1;
-      }
-    }
-  }
-
-  return DeltaTime(cycle, delta);
+  return fromPacked(_ordinal - shift);
 }
 
 namespace std {
@@ -1,7 +1,9 @@
 #pragma once
 #include <time/Time.hpp>
 
-#include <boost/functional/hash.hpp>
+#include <cassert>
+#include <functional>
+#include <iosfwd>
 
 namespace svt {
 
@@ -10,49 +12,63 @@ namespace svt {
 #define SIMCYCLE_BITWIDTH 56
 #define DELTACYCLE_BITWIDTH 8
 
+/**
+ * A DeltaTime packed into a single integer:
+ *   (simcycle << DELTACYCLE_BITWIDTH) | deltacycle
+ * Comparing two packed values gives the same order as comparing the
+ * DeltaTimes they were created from.
+ */
+typedef Time PackedDeltaTime;
+
+/**
+ * A point in simulation time, stored as its packed ordinal so that every
+ * comparison is a single integer compare.
+ */
 class DeltaTime {
 public:
-  static const Time MaxDeltaTime; // 2^DELTACYCLE_BITWIDTH
-  static const Time MaxSimTime;   // 2^SIMCYCLE_BITWIDTH
+  static constexpr Time MaxDeltaTime =
+      (Time(1) << DELTACYCLE_BITWIDTH) - 1; // 2^DELTACYCLE_BITWIDTH - 1
+  static constexpr Time MaxSimTime =
+      (Time(1) << SIMCYCLE_BITWIDTH) - 1; // 2^SIMCYCLE_BITWIDTH - 1
 
 public:
-  DeltaTime() : _data(0, 0) {}
+  constexpr DeltaTime() : _ordinal(0) {}
 
-  DeltaTime(const Time &simCycle, const Time &deltaCycle)
-      : _data(simCycle, deltaCycle) {}
+  constexpr DeltaTime(const Time &simCycle, const Time &deltaCycle)
+      : _ordinal((simCycle << DELTACYCLE_BITWIDTH) |
+                 (deltaCycle & MaxDeltaTime)) {}
 
   static const DeltaTime initTime;
 
-  bool operator<(const DeltaTime &other) const {
-    return (_data._simcycle < other._data._simcycle) ||
-           (_data._simcycle == other._data._simcycle &&
-            _data._deltacycle < other._data._deltacycle);
+  static constexpr DeltaTime fromPacked(PackedDeltaTime packed) {
+    return DeltaTime(packed >> DELTACYCLE_BITWIDTH, packed & MaxDeltaTime);
   }
 
-  bool operator<=(const DeltaTime &other) const {
-    return (_data._simcycle < other._data._simcycle) ||
-           (_data._simcycle == other._data._simcycle &&
-            _data._deltacycle <= other._data._deltacycle);
+  constexpr PackedDeltaTime packed() const { return _ordinal; }
+
+  constexpr bool operator<(const DeltaTime &other) const {
+    return _ordinal < other._ordinal;
   }
 
-  bool operator>(const DeltaTime &other) const {
-    return (_data._simcycle > other._data._simcycle) ||
-           (_data._simcycle == other._data._simcycle &&
-            _data._deltacycle > other._data._deltacycle);
+  constexpr bool operator<=(const DeltaTime &other) const {
+    return _ordinal <= other._ordinal;
   }
 
-  bool operator>=(const DeltaTime &other) const {
-    return (_data._simcycle >= other._data._simcycle) ||
-           (_data._simcycle == other._data._simcycle &&
-            _data._deltacycle >= other._data._deltacycle);
+  constexpr bool operator>(const DeltaTime &other) const {
+    return _ordinal > other._ordinal;
   }
 
-  bool operator==(const DeltaTime &other) const {
-    return (_data._simcycle == other._data._simcycle) &&
-           (_data._deltacycle == other._data._deltacycle);
+  constexpr bool operator>=(const DeltaTime &other) const {
+    return _ordinal >= other._ordinal;
   }
 
-  bool operator!=(const DeltaTime &other) const { return !operator==(other); }
+  constexpr bool operator==(const DeltaTime &other) const {
+    return _ordinal == other._ordinal;
+  }
+
+  constexpr bool operator!=(const DeltaTime &other) const {
+    return _ordinal != other._ordinal;
+  }
 
   // REVIEW: this operator confuses a lot, "arithmetic" operations should return
   // a const reference of the same object
@@ -62,61 +78,69 @@ public:
   DeltaTime operator-(Time simcycle) const;
 
   DeltaTime previousDeltaTime(const Time &delay = 1) const {
-    if (delay <= _data._deltacycle) {
-      return DeltaTime(_data._simcycle, _data._deltacycle - delay);
+    if (delay <= deltacycle()) {
+      return fromPacked(_ordinal - delay);
     }
 
-    if (_data._simcycle == 0) {
-      return DeltaTime(_data._simcycle, 0);
+    if (simcycle() == 0) {
+      return DeltaTime(0, 0);
     }
 
-    return DeltaTime(_data._simcycle - 1, MaxDeltaTime);
+    // end of the previous cycle
+    return fromPacked((_ordinal & ~MaxDeltaTime) - 1);
   }
 
   DeltaTime nextDeltaTime(const Time &delay = 1) const {
     if (isEndOfCycle()) {
-      return DeltaTime(_data._simcycle + 1, 0);
+      return fromPacked(_ordinal + 1);
     }
 
-    Time d = MaxDeltaTime - _data._deltacycle;
+    Time d = MaxDeltaTime - deltacycle();
     if (delay > d) {
-      return DeltaTime(_data._simcycle + 1, delay - d);
+      return DeltaTime(simcycle() + 1, delay - d);
     }
-    return DeltaTime(_data._simcycle, _data._deltacycle + delay);
+    return fromPacked(_ordinal + delay);
   }
 
-  DeltaTime &operator++();
+  DeltaTime &operator++() {
+    assert(simcycle() < MaxSimTime);
+    _ordinal += Time(1) << DELTACYCLE_BITWIDTH; // may be overlapped on 2^56
+    return *this;
+  }
 
-  Time simcycle() const { return _data._simcycle; }
-  Time deltacycle() const { return _data._deltacycle; }
+  constexpr Time simcycle() const { return _ordinal >> DELTACYCLE_BITWIDTH; }
+  constexpr Time deltacycle() const { return _ordinal & MaxDeltaTime; }
 
-  bool isEndOfCycle() const { return _data._deltacycle == MaxDeltaTime; }
-  bool isBeginOfCycle() const { return _data._deltacycle == 0; }
+  constexpr bool isEndOfCycle() const { return deltacycle() == MaxDeltaTime; }
+  constexpr bool isBeginOfCycle() const { return deltacycle() == 0; }
 
-  bool isBeginOrEndOfCycle() const {
+  constexpr bool isBeginOrEndOfCycle() const {
     return isBeginOfCycle() || isEndOfCycle();
   }
 
   /**
   * change the basetime of a cycle.
+  *
+  * The time is moved by (newBase - oldBase) on the packed ordinal, deltas
+  * carry into and borrow from the simcycle. Times that would move before
+  * 0+0 are clamped to 0+0.
   */
   DeltaTime rebase(DeltaTime const &oldBase, DeltaTime const &newBase) const;
 
 private:
-  struct TimeData {
-    TimeData(Time simcycle, Time deltacycle)
-        : _simcycle(simcycle), _deltacycle(deltacycle) {}
-
-    Time _simcycle : SIMCYCLE_BITWIDTH;
-    Time _deltacycle : DELTACYCLE_BITWIDTH;
-  } _data;
+  PackedDeltaTime _ordinal;
 };
 
+/**
+ * mix the bits of the packed ordinal (finalizer of MurmurHash3), consecutive
+ * times must not end up in consecutive buckets.
+ */
 inline std::size_t hash_value(svt::DeltaTime const &dt) {
-  std::size_t ret = 0;
-  boost::hash_combine(ret, dt.simcycle());
-  boost::hash_combine(ret, dt.deltacycle());
-  return ret;
+  Time h = dt.packed();
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return static_cast<std::size_t>(h);
 }
 
 inline DeltaTime endOfCycle(const Time t) {
@@ -126,6 +150,12 @@ inline DeltaTime endOfCycle(const Time t) {
 } // end namespace svt
 
 namespace std {
+template <> struct hash<svt::DeltaTime> {
+  std::size_t operator()(svt::DeltaTime const &dt) const {
+    return svt::hash_value(dt);
+  }
+};
+
 std::ostream &operator<<(std::ostream &os, const svt::DeltaTime &a);
 std::istream &operator>>(std::istream &is, svt::DeltaTime &a);
 }
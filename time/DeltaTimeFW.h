@@ -6,6 +6,11 @@
 #include <boost/flyweight/hashed_factory.hpp>
 
 namespace svt {
+/**
+ * Flyweight DeltaTime, kept for code that still shares DeltaTime instances.
+ * Trace stores PackedDeltaTime and does not depend on this type; a
+ * DeltaTimeFW converts implicitly to the DeltaTime const & it expects.
+ */
 typedef boost::flyweight<DeltaTime, boost::flyweights::hashed_factory<>>
     DeltaTimeFW;
 } /* namespace svt */
@@ -1,4 +1,6 @@
 #pragma once
 
+#include <stdint.h>
+
 // replacement for a enum based Bit type.
 typedef uint8_t Bit;
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "Bit.h"
+
+#include <time/DeltaTime.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+namespace svt {
+
+/**
+ * The read-only form of a frame in a region of a Trace that is not written
+ * any more, see BasicTrace::compact.
+ *
+ * Only the differences between neighbouring times are stored, bit-packed
+ * with the width of the largest difference. The values follow the same way,
+ * except for two-state frames which only keep their two values. The time of
+ * the first entry is the leader kept by BasicTraceFrameSeq.
+ *
+ * The packed entries are stored directly behind the object, a compressed
+ * frame occupies size() bytes.
+ **/
+class CompressedTraceFrame {
+public:
+  /**
+   * bytes needed to compress frame, 0 if the differences of its times are
+   * too large to be worth packing.
+   **/
+  template <class Frame> static std::size_t size_for(Frame const &frame);
+
+  // the storage must be at least size_for(frame) bytes
+  template <class Frame> explicit CompressedTraceFrame(Frame const &frame);
+
+  std::size_t size() const;
+  unsigned num_used() const { return _used; }
+
+  // owners besides the first one, see BasicTraceFramePool::share
+  static const unsigned MaxShares = 0xffff;
+  unsigned shares() const { return _shares; }
+  void set_shares(unsigned shares) { _shares = shares; }
+
+  // replace the entries of frame by the compressed ones
+  template <class Frame>
+  void decompress(PackedDeltaTime leader, Frame &frame) const;
+
+private:
+  static const unsigned MaxTimeBits = 56;
+  static const unsigned ReadPadding = 8;
+
+  static unsigned bits_for(unsigned long long value);
+  static std::size_t size_for(unsigned used, unsigned timeBits,
+                              unsigned valueBits, bool twoState);
+
+  uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+  uint8_t const *data() const {
+    return reinterpret_cast<uint8_t const *>(this + 1);
+  }
+
+  class BitWriter;
+  class BitReader;
+
+  uint16_t _used;
+  uint16_t _shares;
+  uint8_t _timeBits;
+  uint8_t _valueBits;
+  bool _twoState;
+  Bit _toggles[2];
+};
+
+// writes values of up to MaxTimeBits bits, the lowest bit first
+class CompressedTraceFrame::BitWriter {
+public:
+  explicit BitWriter(uint8_t *out) : _out(out), _buffer(0), _filled(0) {}
+
+  void write(unsigned long long value, unsigned bits) {
+    _buffer |= value << _filled;
+    _filled += bits;
+    while (_filled >= 8) {
+      *_out++ = static_cast<uint8_t>(_buffer);
+      _buffer >>= 8;
+      _filled -= 8;
+    }
+  }
+
+  void flush() {
+    if (_filled > 0) {
+      *_out++ = static_cast<uint8_t>(_buffer);
+    }
+  }
+
+private:
+  uint8_t *_out;
+  unsigned long long _buffer;
+  unsigned _filled;
+};
+
+// reads the stream of a BitWriter a word at a time, the stream must be
+// followed by at least ReadPadding readable bytes
+class CompressedTraceFrame::BitReader {
+public:
+  explicit BitReader(uint8_t const *in) : _in(in), _pos(0) {}
+
+  unsigned long long read(unsigned bits) {
+    uint8_t const *bytes = _in + _pos / 8;
+    unsigned long long word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::memcpy(&word, bytes, sizeof(word));
+#else
+    for (unsigned i = 0; i < sizeof(word); ++i) {
+      word |= static_cast<unsigned long long>(bytes[i]) << (8 * i);
+    }
+#endif
+    word >>= _pos % 8;
+    _pos += bits;
+    return word & ((1ull << bits) - 1);
+  }
+
+private:
+  uint8_t const *_in;
+  std::size_t _pos;
+};
+
+inline unsigned CompressedTraceFrame::bits_for(unsigned long long value) {
+  unsigned bits = 0;
+  for (; value != 0; value >>= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+inline std::size_t CompressedTraceFrame::size_for(unsigned used,
+                                                  unsigned timeBits,
+                                                  unsigned valueBits,
+                                                  bool twoState) {
+  std::size_t bits = (used - 1) * timeBits + (twoState ? 0 : used * valueBits);
+  return sizeof(CompressedTraceFrame) + (bits + 7) / 8;
+}
+
+inline std::size_t CompressedTraceFrame::size() const {
+  return size_for(_used, _timeBits, _valueBits, _twoState);
+}
+
+template <class Frame>
+std::size_t CompressedTraceFrame::size_for(Frame const &frame) {
+  assert(!frame.empty());
+
+  PackedDeltaTime maxGap = 0;
+  Bit maxValue = 0;
+  for (unsigned i = 0; i < frame.num_used(); ++i) {
+    if (i > 0) {
+      maxGap = std::max(maxGap, frame.time_at(i) - frame.time_at(i - 1));
+    }
+    maxValue = std::max(maxValue, frame.bit_at(i));
+  }
+
+  if (bits_for(maxGap) > MaxTimeBits) {
+    return 0;
+  }
+  return size_for(frame.num_used(), bits_for(maxGap), bits_for(maxValue),
+                  frame.two_state());
+}
+
+template <class Frame>
+CompressedTraceFrame::CompressedTraceFrame(Frame const &frame)
+    : _used(frame.num_used()), _shares(0), _timeBits(0), _valueBits(0),
+      _twoState(frame.two_state()) {
+  for (unsigned i = 0; i < _used; ++i) {
+    if (i > 0) {
+      unsigned bits = bits_for(frame.time_at(i) - frame.time_at(i - 1));
+      _timeBits = std::max<unsigned>(_timeBits, bits);
+    }
+    _valueBits = std::max<unsigned>(_valueBits, bits_for(frame.bit_at(i)));
+  }
+  assert(_timeBits <= MaxTimeBits);
+
+  _toggles[0] = frame.bit_at(0);
+  _toggles[1] = frame.bit_at(_used > 1 ? 1 : 0);
+  if (_twoState) {
+    _valueBits = 0;
+  }
+
+  // the difference to the previous time and the value of every entry, the
+  // writer does not mask, so the values of two-state frames are skipped
+  BitWriter out(data());
+  for (unsigned i = 0; i < _used; ++i) {
+    if (i > 0) {
+      out.write(frame.time_at(i) - frame.time_at(i - 1), _timeBits);
+    }
+    if (!_twoState) {
+      out.write(frame.bit_at(i), _valueBits);
+    }
+  }
+  out.flush();
+}
+
+template <class Frame>
+void CompressedTraceFrame::decompress(PackedDeltaTime leader,
+                                      Frame &frame) const {
+  // the stores to the Bit arrays may alias this frame, copies of the
+  // header let the loops keep it in registers
+  const unsigned used = _used;
+  const unsigned timeBits = _timeBits;
+  const unsigned valueBits = _valueBits;
+
+  PackedDeltaTime times[Frame::max_size];
+  Bit values[Frame::max_size];
+
+  // a padded copy lets every read load a whole word
+  const std::size_t packedSize = size() - sizeof(CompressedTraceFrame);
+  uint8_t packed[(Frame::max_size * (MaxTimeBits + 8) + 7) / 8 + ReadPadding];
+  std::memcpy(packed, data(), packedSize);
+  std::memset(packed + packedSize, 0, ReadPadding);
+
+  BitReader in(packed);
+  PackedDeltaTime time = leader;
+  times[0] = time;
+  if (_twoState) {
+    for (unsigned i = 1; i < used; ++i) {
+      time += in.read(timeBits);
+      times[i] = time;
+    }
+    const Bit even = _toggles[0];
+    const Bit odd = _toggles[1];
+    for (unsigned i = 0; i < used; ++i) {
+      values[i] = i % 2 == 0 ? even : odd;
+    }
+  } else {
+    values[0] = in.read(valueBits);
+    for (unsigned i = 1; i < used; ++i) {
+      time += in.read(timeBits);
+      times[i] = time;
+      values[i] = in.read(valueBits);
+    }
+  }
+  frame.assign(times, values, used);
+}
+
+} // namespace svt
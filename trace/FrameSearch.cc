@@ -0,0 +1,195 @@
+#include "FrameSearch.h"
+
+#include <algorithm>
+#include <atomic>
+
+// the SIMD kernels are compiled with function level target attributes and
+// only called after checking the cpu, the rest of the build needs no -m
+// flags. Other compilers and architectures use the portable kernels.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) &&         \
+    (defined(__clang__) || __GNUC__ > 4 ||                                     \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SVT_FRAME_SEARCH_X86 1
+#include <immintrin.h>
+#else
+#define SVT_FRAME_SEARCH_X86 0
+#endif
+
+namespace svt {
+
+namespace {
+
+// ranges up to this size are scanned completely, larger ones are narrowed
+// down with binary steps first
+const unsigned ScanLimit = 64;
+
+typedef unsigned (*SearchFunction)(PackedDeltaTime const *, unsigned,
+                                   PackedDeltaTime);
+
+unsigned search_binary(PackedDeltaTime const *times, unsigned count,
+                       PackedDeltaTime t) {
+  return std::lower_bound(times, times + count, t) - times;
+}
+
+unsigned search_linear(PackedDeltaTime const *times, unsigned count,
+                       PackedDeltaTime t) {
+  unsigned less = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    less += (times[i] < t);
+  }
+  return less;
+}
+
+#if SVT_FRAME_SEARCH_X86
+// pcmpgtq compares signed, flipping the sign bit of both sides gives the
+// unsigned order
+const long long SignBit = 0x8000000000000000ll;
+
+__attribute__((target("sse4.2,popcnt"))) unsigned
+search_sse42(PackedDeltaTime const *times, unsigned count, PackedDeltaTime t) {
+  const __m128i sign = _mm_set1_epi64x(SignBit);
+  const __m128i key = _mm_xor_si128(_mm_set1_epi64x(t), sign);
+
+  unsigned less = 0;
+  unsigned i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(times + i));
+    __m128i lt = _mm_cmpgt_epi64(key, _mm_xor_si128(v, sign));
+    less += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(lt)));
+  }
+  for (; i < count; ++i) {
+    less += (times[i] < t);
+  }
+  return less;
+}
+
+__attribute__((target("avx2,popcnt"))) unsigned
+search_avx2(PackedDeltaTime const *times, unsigned count, PackedDeltaTime t) {
+  const __m256i sign = _mm256_set1_epi64x(SignBit);
+  const __m256i key = _mm256_xor_si256(_mm256_set1_epi64x(t), sign);
+
+  unsigned less = 0;
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(times + i));
+    __m256i lt = _mm256_cmpgt_epi64(key, _mm256_xor_si256(v, sign));
+    less += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+  }
+  for (; i < count; ++i) {
+    less += (times[i] < t);
+  }
+  return less;
+}
+#endif
+
+SearchFunction function_of(FrameSearchKernel kernel) {
+  switch (kernel) {
+  case FRAME_SEARCH_BINARY:
+    return &search_binary;
+  case FRAME_SEARCH_LINEAR:
+    return &search_linear;
+#if SVT_FRAME_SEARCH_X86
+  case FRAME_SEARCH_SSE42:
+    return &search_sse42;
+  case FRAME_SEARCH_AVX2:
+    return &search_avx2;
+#endif
+  default:
+    return NULL;
+  }
+}
+
+FrameSearchKernel best_kernel() {
+#if SVT_FRAME_SEARCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return FRAME_SEARCH_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return FRAME_SEARCH_SSE42;
+  }
+#endif
+  return FRAME_SEARCH_LINEAR;
+}
+
+unsigned search_first_call(PackedDeltaTime const *times, unsigned count,
+                           PackedDeltaTime t);
+
+// constant initialized, so a search from the static initializer of another
+// translation unit finds them set. FRAME_SEARCH_AUTO is resolved by the
+// first search. Atomic as threads may search first at once, relaxed as every
+// kernel finds the same position, a thread that still sees the old function
+// only searches a little slower.
+std::atomic<FrameSearchKernel> selectedKernel(FRAME_SEARCH_AUTO);
+std::atomic<SearchFunction> selectedFunction(&search_first_call);
+
+void resolve_auto() {
+  if (selectedKernel.load(std::memory_order_relaxed) == FRAME_SEARCH_AUTO) {
+    static const FrameSearchKernel best = best_kernel();
+    selectedKernel.store(best, std::memory_order_relaxed);
+    selectedFunction.store(function_of(best), std::memory_order_relaxed);
+  }
+}
+
+unsigned search_first_call(PackedDeltaTime const *times, unsigned count,
+                           PackedDeltaTime t) {
+  resolve_auto();
+  return selectedFunction.load(std::memory_order_relaxed)(times, count, t);
+}
+
+} // end local helper functions
+
+unsigned frame_lower_bound(PackedDeltaTime const *times, unsigned count,
+                           PackedDeltaTime t) {
+  unsigned first = 0;
+  while (count > ScanLimit) {
+    unsigned half = count / 2;
+    if (times[first + half] < t) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  SearchFunction search = selectedFunction.load(std::memory_order_relaxed);
+  return first + search(times + first, count, t);
+}
+
+bool frame_search_supported(FrameSearchKernel kernel) {
+  switch (kernel) {
+  case FRAME_SEARCH_AUTO:
+  case FRAME_SEARCH_BINARY:
+  case FRAME_SEARCH_LINEAR:
+    return true;
+#if SVT_FRAME_SEARCH_X86
+  case FRAME_SEARCH_SSE42:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+  case FRAME_SEARCH_AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+bool select_frame_search(FrameSearchKernel kernel) {
+  if (!frame_search_supported(kernel)) {
+    return false;
+  }
+  if (kernel == FRAME_SEARCH_AUTO) {
+    kernel = best_kernel();
+  }
+  selectedKernel.store(kernel, std::memory_order_relaxed);
+  selectedFunction.store(function_of(kernel), std::memory_order_relaxed);
+  return true;
+}
+
+FrameSearchKernel selected_frame_search() {
+  resolve_auto();
+  return selectedKernel.load(std::memory_order_relaxed);
+}
+
+} // namespace svt
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+
+namespace svt {
+
+/**
+ * The kernels available to search a time inside a frame.
+ **/
+enum FrameSearchKernel {
+  /**
+   * The fastest kernel supported by the cpu, determined by the first search.
+   **/
+  FRAME_SEARCH_AUTO = 0,
+
+  /**
+   * std::lower_bound, branches on every step.
+   **/
+  FRAME_SEARCH_BINARY = 1,
+
+  /**
+   * Counts all entries before the time without branching, portable.
+   **/
+  FRAME_SEARCH_LINEAR = 2,
+
+  /**
+   * Compares two entries per instruction (pcmpgtq), x86 with SSE4.2 only.
+   **/
+  FRAME_SEARCH_SSE42 = 3,
+
+  /**
+   * Compares four entries per instruction (vpcmpgtq), x86 with AVX2 only.
+   **/
+  FRAME_SEARCH_AVX2 = 4,
+};
+
+/**
+ * Position of the first entry in the sorted range times[0, count) that is
+ * not before t, using the selected kernel.
+ **/
+unsigned frame_lower_bound(PackedDeltaTime const *times, unsigned count,
+                           PackedDeltaTime t);
+
+bool frame_search_supported(FrameSearchKernel kernel);
+
+/**
+ * Select the kernel used by frame_lower_bound for all Traces. Returns false
+ * and keeps the current kernel if the cpu does not support it.
+ **/
+bool select_frame_search(FrameSearchKernel kernel);
+
+/**
+ * The kernel in use, FRAME_SEARCH_AUTO is resolved to the actual kernel.
+ **/
+FrameSearchKernel selected_frame_search();
+
+} // namespace svt
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+
+#include <vector>
+
+namespace svt {
+
+/**
+ * Min-heap of signals keyed by the time of their next change, for merging
+ * the checkpoints of many Traces in time order. The top can be replaced
+ * with a single sift down. Signals with the same time come out in no
+ * particular order. The entries are followed by a sentinel, so every entry
+ * has two children and the smaller one is selected without a branch.
+ **/
+class MergeHeap {
+public:
+  // the time of the unused entries
+  static const Time NoTime = ~Time(0);
+
+  MergeHeap() : _size(0) {}
+
+  bool empty() const { return _size == 0; }
+  std::size_t size() const { return _size; }
+  Time top_time() const { return _times[0]; }
+  std::size_t top_signal() const { return _signals[0]; }
+
+  void reserve(std::size_t size) {
+    _times.reserve(2 * size + 3);
+    _signals.reserve(2 * size + 3);
+  }
+
+  void clear() {
+    _size = 0;
+    _times.clear();
+    _signals.clear();
+  }
+
+  void push(Time time, std::size_t signal) {
+    _times.resize(2 * _size + 3, Time(NoTime));
+    _signals.resize(2 * _size + 3);
+    std::size_t pos = _size++;
+    for (; pos > 0 && time < _times[(pos - 1) / 2]; pos = (pos - 1) / 2) {
+      _times[pos] = _times[(pos - 1) / 2];
+      _signals[pos] = _signals[(pos - 1) / 2];
+    }
+    _times[pos] = time;
+    _signals[pos] = signal;
+  }
+
+  void pop() {
+    --_size;
+    Time time = _times[_size];
+    std::size_t signal = _signals[_size];
+    _times[_size] = NoTime;
+    if (_size > 0) {
+      replace_top(time, signal);
+    }
+  }
+
+  void replace_top(Time time, std::size_t signal) {
+    std::size_t pos = 0;
+    for (;;) {
+      std::size_t child = 2 * pos + 1;
+      child += _times[child + 1] < _times[child];
+      if (!(_times[child] < time)) {
+        break;
+      }
+      _times[pos] = _times[child];
+      _signals[pos] = _signals[child];
+      pos = child;
+    }
+    _times[pos] = time;
+    _signals[pos] = signal;
+  }
+
+private:
+  std::size_t _size;
+  std::vector<Time> _times;
+  std::vector<std::size_t> _signals;
+};
+
+} // namespace svt
@@ -1,11 +1,13 @@
 #include "Trace.h"
 
+#include <trace/TraceDiff.h>
 #include <trace/TraceFrameImpl.h>
 
 #include <boost/optional.hpp>
-#include <boost/lambda/construct.hpp>
 #include <boost/foreach.hpp>
 
+#include <stdexcept>
+
 namespace svt {
 
 ////////////////////////////////////////////////////////////
@@ -15,13 +17,12 @@ std::ostream &operator<<(std::ostream &out, TraceFrameCurser const &curser) {
   return out;
 }
 
-typedef std::vector<TraceFrame *> FrameSeq;
-
 /**
  * move the Curser to the next entry
  **/
+template <class FrameSeq>
 void move_forward(TraceFrameCurser &curser, FrameSeq const &frames) {
-  if (curser.pos < frames[curser.frame]->num_used() - 1) {
+  if (curser.pos < frames.num_used(curser.frame) - 1) {
     ++curser.pos;
   } else {
     curser.pos = 0;
@@ -32,22 +33,24 @@ void move_forward(TraceFrameCurser &curser, FrameSeq const &frames) {
 /**
  * move the Curser to the previous entry
  **/
+template <class FrameSeq>
 void move_backward(TraceFrameCurser &curser, FrameSeq const &frames) {
   if (curser.pos > 0) {
     --curser.pos;
   } else {
     if (curser.frame > 0) {
-      curser.pos = frames[curser.frame - 1]->num_used() - 1;
+      curser.pos = frames.num_used(curser.frame - 1) - 1;
     } else {
-      curser.pos = TraceFrameSize;
+      curser.pos = FrameSeq::Frame::max_size;
     }
     --curser.frame;
   }
 }
 
+template <class FrameSeq>
 bool is_end_of_frame(TraceFrameCurser const &curser, FrameSeq const &frames) {
   return curser.frame < frames.size() &&
-         curser.pos == frames[curser.frame]->num_used();
+         curser.pos == frames.num_used(curser.frame);
 }
 
 /**
@@ -56,27 +59,40 @@ bool is_end_of_frame(TraceFrameCurser const &curser, FrameSeq const &frames) {
  * returns false either if curser.frame is outside the frames or
  * if thr frame is valid but the position is out of the frame
  **/
+template <class FrameSeq>
 bool curser_valid(TraceFrameCurser const &curser, FrameSeq const &frames) {
   return curser.frame < frames.size() &&
-         curser.pos < frames[curser.frame]->num_used();
+         curser.pos < frames.num_used(curser.frame);
 }
 
-DeltaTimeFW &access_time(TraceFrameCurser const &curser, FrameSeq &frames) {
-  return frames[curser.frame]->time_at(curser.pos);
+/**
+ * change the time of the entry at the curser, it must stay between its
+ * neighbours.
+ **/
+template <class FrameSeq>
+void set_time(TraceFrameCurser const &curser, FrameSeq &frames,
+              PackedDeltaTime time) {
+  frames[curser.frame]->time_at(curser.pos) = time;
+  if (curser.pos == 0) {
+    frames.update_leader(curser.frame);
+  }
 }
 
-const DeltaTimeFW &access_time(TraceFrameCurser const &curser,
-                               FrameSeq const &frames) {
+template <class FrameSeq>
+PackedDeltaTime access_time(TraceFrameCurser const &curser,
+                            FrameSeq const &frames) {
   return frames[curser.frame]->time_at(curser.pos);
 }
 
-Bit &access_value(TraceFrameCurser const &curser, FrameSeq &frames) {
+template <class FrameSeq>
+Bit access_value(TraceFrameCurser const &curser, FrameSeq const &frames) {
   return frames[curser.frame]->bit_at(curser.pos);
 }
 
-const Bit &access_value(TraceFrameCurser const &curser,
-                        FrameSeq const &frames) {
-  return frames[curser.frame]->bit_at(curser.pos);
+template <class FrameSeq>
+void set_value(TraceFrameCurser const &curser, FrameSeq &frames,
+               Bit const &value) {
+  frames[curser.frame]->set_bit(curser.pos, value);
 }
 
 /**
@@ -84,16 +100,14 @@ const Bit &access_value(TraceFrameCurser const &curser,
  *exists,
  * or to the point where it has to be inserted.
  **/
+template <class FrameSeq>
 void search_time(TraceFrameCurser &curser, FrameSeq const &frames,
-                 DeltaTimeFW const &time) {
+                 PackedDeltaTime time) {
   if (!frames.empty()) {
-    TraceFrame *back = frames.back();
-    if (back != NULL) {
-      unsigned last = back->num_used();
-      if (last > 0) {
-        --last;
-      }
-      assert(last < TraceFrameSize);
+    typename FrameSeq::Frame const *back = frames.back();
+    if (back != NULL && !back->empty()) {
+      const unsigned last = back->num_used() - 1;
+      assert(last < FrameSeq::Frame::max_size);
       if (back->time_at(last) < time) {
         curser.frame = frames.size() - 1;
         curser.pos = back->num_used();
@@ -102,26 +116,57 @@ void search_time(TraceFrameCurser &curser, FrameSeq const &frames,
     }
   }
 
-  FrameSeq::const_iterator it;
-  it = lower_bound(frames.begin(), frames.end(), time, CompareTraceFrames());
-
-  curser.frame = std::distance(frames.begin(), it);
+  // the last frame starting at or before time
+  curser.frame = frames.upper_bound(time);
 
   if (curser.frame > 0) {
     --curser.frame;
   }
-  TraceFrame &frame = *frames[curser.frame];
+  typename FrameSeq::Frame const &frame = *frames[curser.frame];
+  if (frame.empty()) {
+    // e.g. the only frame of an empty Trace, its times are not initialized
+    curser.pos = 0;
+    return;
+  }
 
-  DeltaTimeFW const *end = frame.end();
-  DeltaTimeFW const *lb = std::lower_bound(frame.begin(), end, time);
-  curser.pos = std::distance(frame.begin(), lb);
+  curser.pos = frame_lower_bound(frame.begin(), frame.num_used(), time);
 
-  if (lb == end && frame.full()) {
+  if (curser.pos == frame.num_used() && frame.full()) {
     curser.pos = 0;
     ++curser.frame;
   }
 }
 
+/**
+ * the position of the first entry at or after time. Unlike search_time it
+ * never stops at the end of a frame that is not full, past the last entry
+ * it is {frames.size(), 0}. The only frame of an empty Trace stays {0, 0}.
+ **/
+template <class FrameSeq>
+TraceFrameCurser first_at_or_after(FrameSeq const &frames,
+                                   PackedDeltaTime time) {
+  TraceFrameCurser curser;
+  search_time(curser, frames, time);
+  if (is_end_of_frame(curser, frames) && curser.pos > 0) {
+    ++curser.frame;
+    curser.pos = 0;
+  }
+  return curser;
+}
+
+/**
+ * the position of the first entry after time, like first_at_or_after(time +
+ * 1) without wrapping around at the largest time.
+ **/
+template <class FrameSeq>
+TraceFrameCurser first_after(FrameSeq const &frames, PackedDeltaTime time) {
+  TraceFrameCurser curser = first_at_or_after(frames, time);
+  if (curser_valid(curser, frames) && access_time(curser, frames) == time) {
+    move_forward(curser, frames);
+  }
+  return curser;
+}
+
 /**
  * insert a new entry at the position before the curser. If it points to the
  *beginning
@@ -131,179 +176,265 @@ void search_time(TraceFrameCurser &curser, FrameSeq const &frames,
  *
  * insert will not check for duplicate value insertion
  **/
-void insert(TraceFrameCurser &curser, FrameSeq &frames, DeltaTimeFW const &time,
+template <class FrameSeq>
+void insert(TraceFrameCurser &curser, FrameSeq &frames,
+            typename FrameSeq::Pool &pool, PackedDeltaTime time,
             Bit const &value) {
   const unsigned pos = curser.pos;
   const unsigned frame = curser.frame;
+  // the last frame is never compressed
+  const bool twoState = frames.back()->two_state();
 
   if (frame < frames.size()) {
     if (!frames[frame]->full()) {
       frames[frame]->insert(pos, time, value);
+      frames.update_leader(frame);
     } else if (pos == 0) {
-      TraceFrame *new_frame = new TraceFrame(time, value);
+      typename FrameSeq::Frame *new_frame =
+          pool.create(time, value, twoState);
       assert(new_frame != NULL);
-      frames.insert(frames.begin() + frame, new_frame);
+      frames.insert(frame, new_frame);
     } else {
-      TraceFrame *new_frame = frames[frame]->split(time);
+      typename FrameSeq::Frame *new_frame = frames[frame]->split(time, pool);
       if (new_frame == NULL) {
         // cannot split because time is before or after the frame
-        TraceFrame *current = frames[frame];
-        new_frame = new TraceFrame(time, value);
+        typename FrameSeq::Frame *current = frames[frame];
+        new_frame = pool.create(time, value, twoState);
         if (time < current->leader()) {
-          frames.insert(frames.begin() + frame, new_frame);
+          frames.insert(frame, new_frame);
         } else {
           assert(time > current->closer());
-          frames.insert(frames.begin() + frame + 1, new_frame);
+          frames.insert(frame + 1, new_frame);
         }
       } else {
         assert(new_frame != NULL);
         frames[frame]->set(time, value);
-        frames.insert(frames.begin() + frame + 1, new_frame);
+        frames.insert(frame + 1, new_frame);
       }
     }
   } else {
-    frames.push_back(new TraceFrame(time, value));
+    frames.push_back(pool.create(time, value, twoState));
   }
 }
 
 /**
  * Remove the entry at the curser position. It must be a valid position
  **/
-void erase(TraceFrameCurser &curser, FrameSeq &frames) {
+template <class FrameSeq>
+void erase(TraceFrameCurser &curser, FrameSeq &frames,
+           typename FrameSeq::Pool &pool) {
   assert(curser_valid(curser, frames));
 
   const unsigned pos = curser.pos;
   const unsigned frame = curser.frame;
 
-  TraceFrame *tf = frames[frame];
+  typename FrameSeq::Frame *tf = frames[frame];
 
-  if (tf->num_used() == 1) {
-    std::copy(frames.begin() + frame + 1, frames.end(), frames.begin() + frame);
-    frames.pop_back();
-    delete tf;
+  if (tf->num_used() == 1 && frames.size() == 1) {
+    // keep the last frame, a Trace always owns at least one
+    tf->reset();
+    frames.update_leader(frame);
+  } else if (tf->num_used() == 1) {
+    frames.erase(frame);
+    pool.destroy(tf);
   } else {
     tf->erase(pos);
+    frames.update_leader(frame);
+  }
+}
+
+// destroy the frame at pos, which may be compressed, but keep its slot
+template <class FrameSeq>
+void destroy_frame(FrameSeq &frames, typename FrameSeq::Pool &pool,
+                   std::size_t pos) {
+  if (frames.compressed(pos)) {
+    pool.destroy(frames.compressed_frame(pos));
+  } else {
+    pool.destroy(frames[pos]);
   }
 }
 
-void truncate_frames(TraceFrameCurser const &curser, FrameSeq &frames) {
+template <class FrameSeq>
+void truncate_frames(TraceFrameCurser const &curser, FrameSeq &frames,
+                     typename FrameSeq::Pool &pool) {
   assert(curser_valid(curser, frames));
 
   const unsigned pos = curser.pos;
   const unsigned frame = curser.frame;
 
   // remove frames after curser;
-  std::for_each(frames.begin() + frame + 1, frames.end(),
-                boost::lambda::delete_ptr());
-  frames.erase(frames.begin() + frame + 1, frames.end());
+  for (unsigned i = frames.size() - 1; i > frame; --i) {
+    pool.destroy(frames[i]);
+  }
+  frames.erase(frame + 1, frames.size());
 
   // remove the rest of the current frame
-  TraceFrame *lastFrame = frames.at(frame);
+  typename FrameSeq::Frame *lastFrame = frames[frame];
 
   lastFrame->truncate(pos);
 
   if (lastFrame->empty()) {
     if (frames.size() != 1) {
-      delete lastFrame;
+      pool.destroy(lastFrame);
       frames.pop_back();
     } else {
       lastFrame->reset();
+      frames.update_leader(frame);
     }
   }
 }
 
 ////////////////////////////////////////////////////////////
 
-Trace::Trace(const Bit &initvalue) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTrace<FrameSize, Encoding>::BasicTrace(const Bit &initvalue,
+                                            FramePoolPtr const &pool)
+    : _pool(pool) {
+  _check_value(initvalue);
   _numberOfReferences = 0;
-  _frames.push_back(new TraceFrame());
+  _frames.push_back(Frame::embed(&_embeddedFrame, true));
   _initvalue = initvalue;
+  _twoState = true;
+  _numTwoStateValues = 0;
+  _autoCompact = false;
+  _repackThreshold = 0;
+  _editsSinceRepackCheck = 0;
+  _sharesFrames = false;
+  _versioned = false;
 }
 
-Trace::~Trace() {
-  for (unsigned i = 0; i < _frames.size(); ++i) {
-    delete _frames[i];
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTrace<FrameSize, Encoding>::~BasicTrace() {
+  // without a pool the only frame is the embedded one
+  if (!_pool) {
+    return;
+  }
+  for (unsigned i = _frames.size(); i > 0; --i) {
+    destroy_frame(_frames, _frame_pool(), i - 1);
   }
 }
 
-Trace::const_iterator Trace::begin() const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTrace<FrameSize, Encoding>::const_iterator
+BasicTrace<FrameSize, Encoding>::begin() const {
   const_iterator ret(_frames);
   ret._curser.frame = 0;
   ret._curser.pos = 0;
   return ret;
 }
 
-Trace::const_iterator Trace::end() const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTrace<FrameSize, Encoding>::const_iterator
+BasicTrace<FrameSize, Encoding>::end() const {
   const_iterator ret(_frames);
   ret._curser.frame = (unsigned)-1;
   ret._curser.pos = (unsigned)-1;
   return ret;
 }
 
-void Trace::add_ref() { ++_numberOfReferences; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTrace<FrameSize, Encoding>::const_iterator
+BasicTrace<FrameSize, Encoding>::lowerBound(DeltaTime const &time) const {
+  const_iterator ret(_frames);
+  search_time(ret._curser, _frames, time.packed());
+  // the end of a frame that is not full, the checkpoint is in the next one
+  if (is_end_of_frame(ret._curser, _frames) &&
+      ret._curser.frame + 1 < _frames.size()) {
+    ++ret._curser.frame;
+    ret._curser.pos = 0;
+  }
+  return ret;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTrace<FrameSize, Encoding>::FramePool &
+BasicTrace<FrameSize, Encoding>::_frame_pool() const {
+  if (!_pool) {
+    _pool = new FramePool();
+  }
+  return *_pool;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::add_ref() { ++_numberOfReferences; }
 
-bool Trace::release() {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::release() {
   if (_numberOfReferences > 0) {
     --_numberOfReferences;
   }
   return _numberOfReferences == 0;
 }
 
-unsigned Trace::numberOfReferences() { return _numberOfReferences; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+unsigned BasicTrace<FrameSize, Encoding>::numberOfReferences() {
+  return _numberOfReferences;
+}
 namespace { // local helper functions
-void merge_earlier(FrameSeq &frames, TraceFrameCurser curser) {
+template <class FrameSeq>
+void merge_earlier(FrameSeq &frames, typename FrameSeq::Pool &pool,
+                   TraceFrameCurser curser) {
   TraceFrameCurser prev(curser);
   move_backward(prev, frames);
 
   if (curser_valid(prev, frames) &&
       access_value(prev, frames) == access_value(curser, frames)) {
     // PRINT_INFO("remove current value");
-    erase(curser, frames);
+    erase(curser, frames, pool);
   }
 }
 
-void merge_later(FrameSeq &frames, TraceFrameCurser curser) {
+template <class FrameSeq>
+void merge_later(FrameSeq &frames, typename FrameSeq::Pool &pool,
+                 TraceFrameCurser curser) {
   TraceFrameCurser next(curser);
   move_forward(next, frames);
 
   if (curser_valid(next, frames)) {
     if (access_value(next, frames) == access_value(curser, frames)) {
       // PRINT_INFO("remove next value");
-      erase(next, frames);
+      erase(next, frames, pool);
     }
   }
 }
 
-void clear_future(FrameSeq &frames, TraceFrameCurser const &curser) {
+template <class FrameSeq>
+void clear_future(FrameSeq &frames, typename FrameSeq::Pool &pool,
+                  TraceFrameCurser const &curser) {
   // delete all later frames
-  for (unsigned i = curser.frame + 1; i < frames.size(); ++i) {
-    delete frames.back();
+  while (frames.size() > curser.frame + 1) {
+    destroy_frame(frames, pool, frames.size() - 1);
     frames.pop_back();
   }
 
-  TraceFrame *frame = frames[curser.frame];
+  typename FrameSeq::Frame *frame = frames[curser.frame];
   // delete all later frames in the current frame
   for (unsigned i = frame->num_used() - 1; i > curser.pos; --i) {
     frame->erase(i);
   }
 }
 
-void append_val(FrameSeq &frames, Bit const &assign, DeltaTimeFW const &atime) {
-  if (frames.empty() || frames.back()->full()) {
-    frames.push_back(new TraceFrame(atime, assign));
+template <class FrameSeq>
+void append_val(FrameSeq &frames, typename FrameSeq::Pool &pool,
+                Bit const &assign, PackedDeltaTime atime) {
+  if (frames.back()->full()) {
+    bool twoState = frames.back()->two_state();
+    frames.push_back(pool.create(atime, assign, twoState));
   } else {
     frames.back()->set(atime, assign);
+    frames.update_leader(frames.size() - 1);
   }
 }
 
 } // end local helper functions
 
-void Trace::_handle_changes(TraceFrameCurser const &curser,
-                            TraceChangeMode const changeMode,
-                            DeltaTimeFW const &atime, Bit curVal) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_handle_changes(
+    TraceFrameCurser const &curser, TraceChangeMode const changeMode,
+    DeltaTime const &atime, Bit curVal) {
 
   if (changeMode & TRACE_KEEP_FUTURE_CYCLE) {
-    set(curVal, DeltaTimeFW(atime.get() + 1), TRACE_MERGE_BOTH);
+    _set(curVal, atime + 1, TRACE_MERGE_BOTH);
   }
 
   if (!curser_valid(curser, _frames)) {
@@ -312,37 +443,59 @@ void Trace::_handle_changes(TraceFrameCurser const &curser,
 
   // the order later then earlier is important to keep curser valid.
   if (changeMode & TRACE_MERGE_LATER) {
-    merge_later(_frames, curser);
+    merge_later(_frames, _frame_pool(), curser);
   }
   if (changeMode & TRACE_MERGE_EARLIER) {
-    merge_earlier(_frames, curser);
+    merge_earlier(_frames, _frame_pool(), curser);
   }
   if (changeMode & TRACE_CLEAR_FUTURE) {
-    clear_future(_frames, curser);
+    clear_future(_frames, _frame_pool(), curser);
   }
 }
 
-void Trace::set(const Bit &assign, const DeltaTimeFW &atime,
-                TraceChangeMode const changeMode) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::set(const Bit &assign,
+                                          const DeltaTime &atime,
+                                          TraceChangeMode const changeMode) {
+  _check_value(assign);
+  _set(assign, atime, changeMode);
+  _repack_if_sparse();
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_set(const Bit &assign,
+                                           const DeltaTime &atime,
+                                           TraceChangeMode const changeMode) {
   assert(!((changeMode & TRACE_KEEP_FUTURE_CYCLE) &&
            (changeMode & TRACE_CLEAR_FUTURE)));
 
+  _thaw_around(atime.packed());
+
+  if (isTwoState()) {
+    if (changeMode == TRACE_MERGE_BOTH && _accept_two_state(assign)) {
+      _set_two_state(assign, atime.packed());
+      return;
+    }
+    _make_general();
+  }
+
+  const PackedDeltaTime packedTime = atime.packed();
   TraceFrameCurser curser;
-  search_time(curser, _frames, atime);
+  search_time(curser, _frames, packedTime);
 
   if (curser_valid(curser, _frames)) {
-    DeltaTime curTime = access_time(curser, _frames);
+    PackedDeltaTime curTime = access_time(curser, _frames);
     Bit curVal = access_value(curser, _frames);
 
-    if (curTime == atime) {
+    if (curTime == packedTime) {
 
       if (curVal != assign) {
-        access_value(curser, _frames) = assign;
+        set_value(curser, _frames, assign);
       }
       _handle_changes(curser, changeMode, atime, curVal);
       return;
 
-    } else if (curTime > atime) {
+    } else if (curTime > packedTime) {
       curVal = _initvalue;
       TraceFrameCurser prev = curser;
       move_backward(prev, _frames);
@@ -354,7 +507,7 @@ void Trace::set(const Bit &assign, const DeltaTimeFW &atime,
         }
       }
 
-      insert(curser, _frames, atime, assign);
+      insert(curser, _frames, _frame_pool(), packedTime, assign);
       _handle_changes(curser, changeMode, atime, curVal);
       return;
 
@@ -374,7 +527,7 @@ void Trace::set(const Bit &assign, const DeltaTimeFW &atime,
       if ((changeMode & TRACE_MERGE_EARLIER) && curVal == assign) {
         return;
       }
-      insert(curser, _frames, atime, assign);
+      insert(curser, _frames, _frame_pool(), packedTime, assign);
       _handle_changes(curser, changeMode, atime, curVal);
       return;
     } else {
@@ -386,7 +539,7 @@ void Trace::set(const Bit &assign, const DeltaTimeFW &atime,
         }
       }
 
-      append_val(_frames, assign, atime);
+      append_val(_frames, _frame_pool(), assign, packedTime);
       Bit curVal = _initvalue;
       move_backward(curser, _frames);
       if (curser_valid(curser, _frames)) {
@@ -401,82 +554,268 @@ void Trace::set(const Bit &assign, const DeltaTimeFW &atime,
   assert(false && "invalid state. All cases should be handled here");
 }
 
-void Trace::setRange(Bit const newValue, DeltaTimeFW const &beginTime,
-                     DeltaTimeFW const &endTime) {
-  assert(beginTime != endTime);
+/**
+ * The checkpoints of a two-state Trace alternate and assign is one of their
+ * values, so TRACE_MERGE_BOTH never has to store equal neighbours: a write
+ * either changes nothing, removes a checkpoint together with its successor,
+ * moves the next checkpoint to time or adds one at the beginning or the end.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_set_two_state(Bit const &assign,
+                                                     PackedDeltaTime time) {
   TraceFrameCurser curser;
-  search_time(curser, _frames, beginTime);
+  search_time(curser, _frames, time);
+  if (is_end_of_frame(curser, _frames) && curser.frame + 1 < _frames.size()) {
+    // the next checkpoint is the first one of the following frame
+    ++curser.frame;
+    curser.pos = 0;
+  }
 
-  Bit lastValue = _initvalue;
-  Bit currentValue = _initvalue;
+  TraceFrameCurser prev = curser;
+  move_backward(prev, _frames);
+  const bool hasPrev = curser_valid(prev, _frames);
+  const Bit prevVal = hasPrev ? access_value(prev, _frames) : _initvalue;
 
-  {
-    TraceFrameCurser prev = curser;
-    move_backward(prev, _frames);
-    if (curser_valid(prev, _frames)) {
-      lastValue = access_value(prev, _frames);
+  if (!curser_valid(curser, _frames)) {
+    if (assign != prevVal) {
+      append_val(_frames, _frame_pool(), assign, time);
     }
+    return;
   }
 
-  if (curser_valid(curser, _frames) &&
-      access_time(curser, _frames) == beginTime) {
-    currentValue = access_value(curser, _frames);
-  } else {
-    currentValue = lastValue;
+  const Bit curVal = access_value(curser, _frames);
+
+  if (access_time(curser, _frames) == time) {
+    if (curVal == assign) {
+      return;
+    }
+    // both neighbours already have the new value
+    TraceFrameCurser next = curser;
+    move_forward(next, _frames);
+    if (curser_valid(next, _frames)) {
+      erase(next, _frames, _frame_pool());
+    }
+    if (hasPrev) {
+      erase(curser, _frames, _frame_pool());
+    } else {
+      set_value(curser, _frames, assign);
+    }
+  } else if (assign != prevVal) {
+    if (curVal == assign) {
+      set_time(curser, _frames, time);
+    } else {
+      assert(!hasPrev && "only the first checkpoint may follow a new value");
+      insert(curser, _frames, _frame_pool(), time, assign);
+    }
   }
+}
 
-  bool doSetBegin = (lastValue != newValue);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::_accept_two_state(Bit const &value) {
+  for (unsigned i = 0; i < _numTwoStateValues; ++i) {
+    if (_twoStateValues[i] == value) {
+      return true;
+    }
+  }
+  if (_numTwoStateValues == 2) {
+    return false;
+  }
+  _twoStateValues[_numTwoStateValues++] = value;
+  return true;
+}
 
-  boost::optional<TraceFrameCurser> beginCurser, endCurser;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_make_general() {
+  if (!isTwoState()) {
+    return;
+  }
+  for (unsigned i = 0; i < _frames.size(); ++i) {
+    // compressed frames keep their form, they are decompressed to the
+    // form of the Trace
+    if (_frames.compressed(i)) {
+      continue;
+    }
+    Frame *twoState = _frames[i];
+    if (twoState->embedded()) {
+      // converted in place, the storage has room for the values
+      PackedDeltaTime storage[sizeof(_embeddedFrame) / sizeof(PackedDeltaTime)];
+      Frame *copy = Frame::embed(storage, true);
+      copy->assign(*twoState);
+      Frame *frame = Frame::embed(&_embeddedFrame, false);
+      frame->assign(*copy);
+      _frames.replace(i, frame);
+      continue;
+    }
+    Frame *frame = _frame_pool().create(false);
+    frame->assign(*twoState);
+    _frames.replace(i, frame);
+    _frame_pool().destroy(twoState);
+  }
+  _twoState = false;
+}
 
-  while (curser_valid(curser, _frames) &&
-         access_time(curser, _frames) <= endTime) {
-    currentValue = access_value(curser, _frames);
-    if (!endCurser) {
-      if (!beginCurser) {
-        beginCurser = curser;
-      } else {
-        endCurser = curser;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_copy_form(BasicTrace const &other) {
+  if (other.isTwoState()) {
+    std::copy(other._twoStateValues,
+              other._twoStateValues + other._numTwoStateValues,
+              _twoStateValues);
+    _numTwoStateValues = other._numTwoStateValues;
+  } else {
+    _make_general();
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::appendBatch(DeltaTime const *times,
+                                                  Bit const *values,
+                                                  std::size_t count) {
+  _check_values(values, count);
+  std::size_t i = 0;
+
+  // entries that are not after the last checkpoint take the general path
+  while (i < count && !_frames.back()->empty() &&
+         times[i].packed() <= _frames.back()->closer()) {
+    appendMonotonic(values[i], times[i]);
+    ++i;
+  }
+
+  if (isTwoState()) {
+    for (std::size_t j = i; j < count; ++j) {
+      if (!_accept_two_state(values[j])) {
+        _make_general();
+        break;
       }
-      move_forward(curser, _frames);
-    } else {
-      erase(curser, _frames);
     }
   }
 
-  bool doSetEnd = (currentValue != newValue);
+  if (_sharesFrames && !_frames.back()->full()) {
+    _thaw_frames(_frames.size() - 1, _frames.size());
+  }
+  Frame *tail = _frames.back();
+  Bit lastValue =
+      tail->empty() ? _initvalue : tail->bit_at(tail->num_used() - 1);
+
+  while (i < count) {
+    if (tail->full()) {
+      tail = _frame_pool().create(_twoState);
+      _frames.push_back(tail);
+      _compact_behind_tail();
+    }
+    i += tail->append_changes(times + i, values + i, count - i, lastValue);
+    _frames.update_leader(_frames.size() - 1);
+  }
 
-  if (endCurser) {
+  // the last frame may only have received duplicates
+  if (tail->empty() && _frames.size() > 1) {
+    _frame_pool().destroy(tail);
+    _frames.pop_back();
+  }
+}
 
-    // erase identical successors
-    if (curser_valid(curser, _frames) &&
-        access_value(curser, _frames) == currentValue) {
-      erase(curser, _frames);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::appendRuns(DeltaTime const &start,
+                                                 Bit const *values,
+                                                 Time const *runLengths,
+                                                 std::size_t count) {
+  // before the first chunk is appended
+  _check_values(values, count);
+  DeltaTime times[FrameSize];
+  Bit runValues[FrameSize];
+  DeltaTime time = start;
+  std::size_t chunk = 0;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    // the next run starts at the same time and replaces the value
+    if (runLengths[i] == 0 && i + 1 < count) {
+      continue;
     }
-
-    if (doSetEnd) {
-      access_time(*endCurser, _frames) = endTime;
-      access_value(*endCurser, _frames) = currentValue;
-    } else {
-      erase(*endCurser, _frames);
+    times[chunk] = time;
+    runValues[chunk] = values[i];
+    time = DeltaTime(time.simcycle() + runLengths[i], time.deltacycle());
+    if (++chunk == FrameSize) {
+      appendBatch(times, runValues, chunk);
+      chunk = 0;
     }
-  } else if (doSetEnd) {
-    insert(curser, _frames, endTime, currentValue);
   }
+  if (chunk > 0) {
+    appendBatch(times, runValues, chunk);
+  }
+}
 
-  if (beginCurser) {
-    if (doSetBegin) {
-      access_time(*beginCurser, _frames) = beginTime;
-      access_value(*beginCurser, _frames) = newValue;
-    } else {
-      erase(*beginCurser, _frames);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::setRange(Bit const newValue,
+                                               DeltaTime const &beginT,
+                                               DeltaTime const &endT) {
+  assert(beginT < endT);
+  _check_value(newValue);
+  _make_general();
+  const PackedDeltaTime beginTime = beginT.packed();
+  const PackedDeltaTime endTime = endT.packed();
+  _thaw_around(beginTime);
+  _thaw_around(endTime);
+
+  const Bit lastValue = _value_before(beginTime);
+  const Bit endValue = get(endT);
+  _erase_range(first_at_or_after(_frames, beginTime),
+               first_after(_frames, endTime));
+
+  TraceFrameCurser curser;
+  if (endValue != newValue) {
+    curser = first_at_or_after(_frames, endTime);
+    insert(curser, _frames, _frame_pool(), endTime, endValue);
+  }
+  // the next checkpoint may repeat the value at endT now
+  curser = first_after(_frames, endTime);
+  if (curser_valid(curser, _frames) &&
+      access_value(curser, _frames) == endValue) {
+    erase(curser, _frames, _frame_pool());
+  }
+  if (lastValue != newValue) {
+    curser = first_at_or_after(_frames, beginTime);
+    insert(curser, _frames, _frame_pool(), beginTime, newValue);
+  }
+  _repack_if_sparse();
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::removeRange(DeltaTime const &beginT,
+                                                  DeltaTime const &endT,
+                                                  bool shift) {
+  assert(beginT < endT);
+  const PackedDeltaTime beginTime = beginT.packed();
+  if (!shift) {
+    setRange(_value_before(beginTime), beginT, endT);
+    return;
+  }
+
+  _make_general();
+  const PackedDeltaTime endTime = endT.packed();
+  _thaw_around(beginTime);
+  _thaw_around(endTime);
+
+  const Bit lastValue = _value_before(beginTime);
+  const Bit endValue = get(endT);
+  _erase_range(first_at_or_after(_frames, beginTime),
+               first_at_or_after(_frames, endTime));
+  _shift_frames(endT, beginT);
+
+  // a checkpoint at endT is at beginT now
+  TraceFrameCurser curser = first_at_or_after(_frames, beginTime);
+  if (curser_valid(curser, _frames) &&
+      access_time(curser, _frames) == beginTime) {
+    if (access_value(curser, _frames) == lastValue) {
+      erase(curser, _frames, _frame_pool());
     }
-  } else if (doSetBegin) {
-    insert(curser, _frames, beginTime, newValue);
+  } else if (endValue != lastValue) {
+    insert(curser, _frames, _frame_pool(), beginTime, endValue);
   }
+  _repack_if_sparse();
 }
 
-Bit Trace::get(const DeltaTimeFW &t) const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+Bit BasicTrace<FrameSize, Encoding>::get(const DeltaTime &time) const {
+  const PackedDeltaTime t = time.packed();
   TraceFrameCurser curser;
   search_time(curser, _frames, t);
   Bit value = _initvalue;
@@ -493,78 +832,180 @@ Bit Trace::get(const DeltaTimeFW &t) const {
   return value;
 }
 
-void Trace::set(const Bit &assign, const DeltaTimeFW &time) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::set(const Bit &assign,
+                                          const DeltaTime &time) {
   set(assign, time, TRACE_MERGE_BOTH);
 }
 
-DeltaTime Trace::checkpoint(const DeltaTime &atimeT) const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::appendMonotonic(const Bit &assign,
+                                                      const DeltaTime &time) {
+  _check_value(assign);
+  const PackedDeltaTime packedTime = time.packed();
+  Frame const *tail = _frames.back();
+
+  Bit lastValue = _initvalue;
+  if (!tail->empty()) {
+    if (packedTime <= tail->closer()) {
+      // time goes backwards
+      set(assign, time, TRACE_MERGE_BOTH);
+      return;
+    }
+    lastValue = tail->bit_at(tail->num_used() - 1);
+  }
+
+  if (assign == lastValue) {
+    return;
+  }
+  if (isTwoState() && !_accept_two_state(assign)) {
+    _make_general();
+    tail = _frames.back();
+  }
+  if (tail->full()) {
+    _frames.push_back(_frame_pool().create(packedTime, assign, _twoState));
+    _compact_behind_tail();
+  } else {
+    if (_sharesFrames) {
+      _thaw_frames(_frames.size() - 1, _frames.size());
+    }
+    _frames.back()->push_back(packedTime, assign);
+    _frames.update_leader(_frames.size() - 1);
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+DeltaTime
+BasicTrace<FrameSize, Encoding>::checkpoint(const DeltaTime &atimeT) const {
   TraceFrameCurser curser;
-  DeltaTimeFW atime(atimeT);
+  PackedDeltaTime atime = atimeT.packed();
   search_time(curser, _frames, atime);
 
   if (curser_valid(curser, _frames) &&
       (atime == access_time(curser, _frames))) {
-    return atime;
+    return atimeT;
   }
 
   move_backward(curser, _frames);
   if (curser_valid(curser, _frames)) {
-    return access_time(curser, _frames);
+    return DeltaTime::fromPacked(access_time(curser, _frames));
   } else {
     return DeltaTime(0, 0);
   }
 }
 
-std::vector<DeltaTimeFW> Trace::computeCheckpoints() const {
-  std::vector<DeltaTimeFW> ret;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::vector<DeltaTime>
+BasicTrace<FrameSize, Encoding>::computeCheckpoints() const {
+  std::vector<DeltaTime> ret;
+
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    BOOST_FOREACH (PackedDeltaTime t, *_frames[i]) {
+      ret.push_back(DeltaTime::fromPacked(t));
+    }
+  }
+
+  return ret;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::vector<Bit> BasicTrace<FrameSize, Encoding>::computeValues() const {
+  std::vector<Bit> ret(numberOfCheckpoints());
 
-  BOOST_FOREACH (const TraceFrame *tf, _frames) {
-    BOOST_FOREACH (const DeltaTimeFW &t, *tf) { ret.push_back(t); }
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    Frame const *tf = _frames[i];
+    tf->decode_bits(0, tf->num_used(), ret.data() + pos);
+    pos += tf->num_used();
   }
 
   return ret;
 }
 
-DeltaTimeFW Trace::firstCheckpoint() const {
-  Trace::const_iterator it = begin();
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+DeltaTime BasicTrace<FrameSize, Encoding>::firstCheckpoint() const {
+  const_iterator it = begin();
   if (it == end()) {
-    DeltaTimeFW result(DeltaTime(0, 0));
-    return result;
+    return DeltaTime(0, 0);
   } else {
     return it.time();
   }
 }
 
-DeltaTimeFW Trace::lastCheckpoint() const {
-  BOOST_REVERSE_FOREACH(TraceFrame * frame, _frames) {
-    if (frame && !frame->num_used() == 0) {
-      return frame->time_at(frame->num_used() - 1);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+DeltaTime BasicTrace<FrameSize, Encoding>::lastCheckpoint() const {
+  for (std::size_t i = _frames.size(); i > 0; --i) {
+    Frame const *frame = _frames[i - 1];
+    if (!frame->num_used() == 0) {
+      return DeltaTime::fromPacked(frame->time_at(frame->num_used() - 1));
     }
   }
 
-  return DeltaTimeFW(DeltaTime(0, 0));
+  return DeltaTime(0, 0);
 }
 
-bool Trace::hasCheckpoints() const {
-  return !_frames.empty() && _frames.front()->num_used() != 0;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::hasCheckpoints() const {
+  return !_frames.empty() && _frames.num_used(0) != 0;
 }
 
-std::size_t Trace::numberOfCheckpoints() const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::size_t BasicTrace<FrameSize, Encoding>::numberOfCheckpoints() const {
   size_t result = 0;
 
-  BOOST_FOREACH (const TraceFrame *tf, _frames) { result += tf->num_used(); }
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    result += _frames.num_used(i);
+  }
 
   return result;
 }
 
-std::size_t Trace::capacity() const { return _frames.size() * TraceFrameSize; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::size_t BasicTrace<FrameSize, Encoding>::capacity() const {
+  std::size_t result = 0;
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    if (!_frames.compressed(i)) {
+      result += _frames[i]->capacity();
+    }
+  }
+  return result;
+}
 
-boost::optional<DeltaTimeFW>
-Trace::prevCheckpoint(const DeltaTimeFW &baseTime) const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+uint64_t BasicTrace<FrameSize, Encoding>::fingerprint() const {
+  uint64_t result = _initvalue * 0x9e3779b97f4a7c15ull;
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    result += _frames[i]->hash();
+  }
+  return result;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+TraceMemoryUsage BasicTrace<FrameSize, Encoding>::memoryUsage() const {
+  TraceMemoryUsage usage = {0, 0, _frames.bytes(), sizeof(BasicTrace), 0, 0};
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    if (_frames.compressed(i)) {
+      usage.compressedBytes += _frames.compressed_frame(i)->size();
+    } else {
+      // an embedded frame is part of the Trace object
+      Frame const *frame = _frames[i];
+      usage.frameBytes +=
+          frame->embedded() ? 0 : Frame::storage_size(_twoState);
+      usage.used += frame->num_used();
+      usage.capacity += frame->capacity();
+    }
+  }
+  return usage;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+boost::optional<DeltaTime>
+BasicTrace<FrameSize, Encoding>::prevCheckpoint(const DeltaTime &baseT) const {
   if (!hasCheckpoints()) {
     return boost::none;
   }
 
+  const PackedDeltaTime baseTime = baseT.packed();
   TraceFrameCurser c;
   search_time(c, _frames, baseTime);
 
@@ -577,30 +1018,32 @@ Trace::prevCheckpoint(const DeltaTimeFW &baseTime) const {
   }
 
   if (curser_valid(c, _frames)) {
-    return access_time(c, _frames);
+    return DeltaTime::fromPacked(access_time(c, _frames));
   } else {
     return boost::none;
   }
 }
 
-boost::optional<DeltaTimeFW>
-Trace::nextCheckpoint(DeltaTimeFW const &baseTime) const {
-  TraceFrameCurser c;
-  search_time(c, _frames, baseTime);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+boost::optional<DeltaTime>
+BasicTrace<FrameSize, Encoding>::nextCheckpoint(DeltaTime const &baseT) const {
+  const PackedDeltaTime baseTime = baseT.packed();
+  TraceFrameCurser c = first_at_or_after(_frames, baseTime);
 
   while (curser_valid(c, _frames) && access_time(c, _frames) <= baseTime) {
     move_forward(c, _frames);
   }
 
   if (curser_valid(c, _frames)) {
-    return access_time(c, _frames);
+    return DeltaTime::fromPacked(access_time(c, _frames));
   } else {
     return boost::none;
   }
 }
 
-bool Trace::changed(const DeltaTime &timeT) const {
-  DeltaTimeFW time(timeT);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::changed(const DeltaTime &timeT) const {
+  PackedDeltaTime time = timeT.packed();
   TraceFrameCurser curser;
 
   Bit currentVal = _initvalue;
@@ -617,7 +1060,8 @@ bool Trace::changed(const DeltaTime &timeT) const {
   }
 
   while (curser_valid(curser, _frames) &&
-         access_time(curser, _frames).get().simcycle() == timeT.simcycle()) {
+         DeltaTime::fromPacked(access_time(curser, _frames)).simcycle() ==
+             timeT.simcycle()) {
     move_backward(curser, _frames);
   }
 
@@ -633,11 +1077,7 @@ bool Trace::changed(const DeltaTime &timeT) const {
 
 namespace {
 
-class DifferenceFound : std::exception {};
-
-void throwOnDifference(DeltaTime, Bit, Bit) { throw DifferenceFound(); }
-
-class DoCompareTraces {
+template <class Trace> class DoCompareTraces {
 public:
   DoCompareTraces(Trace const &a, Trace const &b,
                   boost::function<void(DeltaTime, Bit, Bit)> const &log)
@@ -718,57 +1158,321 @@ private:
 
 private:
   bool _result;
-  DeltaTimeFW _currentTime;
-  Trace::const_iterator _itA;
-  Trace::const_iterator const _endA;
+  DeltaTime _currentTime;
+  typename Trace::const_iterator _itA;
+  typename Trace::const_iterator const _endA;
   Bit _currentA;
-  Trace::const_iterator _itB;
-  Trace::const_iterator const _endB;
+  typename Trace::const_iterator _itB;
+  typename Trace::const_iterator const _endB;
   Bit _currentB;
   boost::function<void(DeltaTime, Bit, Bit)> const &_log;
 };
 }
 
-bool compare_traces(Trace const &a, Trace const &b,
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool compare_traces(BasicTrace<FrameSize, Encoding> const &a,
+                    BasicTrace<FrameSize, Encoding> const &b,
                     boost::function<void(DeltaTime, Bit, Bit)> log) {
-  DoCompareTraces comparator(a, b, log);
+  DoCompareTraces<BasicTrace<FrameSize, Encoding> > comparator(a, b, log);
   return comparator();
 }
 
-bool operator==(Trace const &a, Trace const &b) {
-  try {
-    return compare_traces(a, b, &throwOnDifference);
-  } catch (DifferenceFound const &) {
-    return false;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool operator==(BasicTrace<FrameSize, Encoding> const &a,
+                BasicTrace<FrameSize, Encoding> const &b) {
+  if (&a == &b) {
+    return true;
+  }
+  typedef BasicTraceFrameSeq<FrameSize, Encoding> FrameSeq;
+  TraceWalk<FrameSeq> curserA(a._frames, a._initvalue);
+  TraceWalk<FrameSeq> curserB(b._frames, b._initvalue);
+
+  while (!curserA.at_end() && !curserB.at_end()) {
+    if (curserA.at_frame_start() && curserB.at_frame_start() &&
+        same_entries(curserA, curserB)) {
+      curserA.skip_frame();
+      curserB.skip_frame();
+      continue;
+    }
+    curserA.decode();
+    curserB.decode();
+    const PackedDeltaTime timeA = curserA.time();
+    const PackedDeltaTime timeB = curserB.time();
+    if (timeA <= timeB) {
+      curserA.advance();
+    }
+    if (timeB <= timeA) {
+      curserB.advance();
+    }
+    if (curserA.value() != curserB.value()) {
+      return false;
+    }
   }
+  // the rest of the other Trace is compared to the last value of the
+  // finished one
+  return curserA.rest_is(curserB.value()) && curserB.rest_is(curserA.value());
 }
 
-void Trace::clear() {
-  _frames[0]->reset(DeltaTimeFW(DeltaTime(0, 0)));
-  for (unsigned i = 1; i < _frames.size(); ++i) {
-    delete _frames[i];
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::clear() {
+  // release in reverse order, the pool hands out the last released frame
+  // first and a refill gets the frames in their previous order
+  for (unsigned i = _frames.size() - 1; i > 0; --i) {
+    destroy_frame(_frames, _frame_pool(), i);
   }
   _frames.resize(1);
+
+  // start over as a two-state Trace
+  if (_twoState && !_frames.compressed(0) && !_frames.shared(0)) {
+    _frames[0]->reset();
+    _frames.update_leader(0);
+  } else {
+    destroy_frame(_frames, _frame_pool(), 0);
+    _frames.replace(0, Frame::embed(&_embeddedFrame, true));
+  }
+  _twoState = true;
+  _numTwoStateValues = 0;
+  _sharesFrames = false;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::repack() {
+  // the frames are moved down to kept, target is the last of them that
+  // takes entries of the following frames
+  const std::size_t NoTarget = ~std::size_t(0);
+  std::size_t kept = 0;
+  std::size_t target = NoTarget;
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    if (_frames.compressed(i) || _frames.shared(i)) {
+      _frames.move_frame(i, kept++);
+      target = NoTarget;
+      continue;
+    }
+    Frame *frame = _frames[i];
+    if (target != NoTarget) {
+      Frame *to = _frames[target];
+      to->take_front(*frame, std::min(to->capacity() - to->num_used(),
+                                      frame->num_used()));
+      // the target may have been empty
+      _frames.update_leader(target);
+      if (frame->empty()) {
+        _frame_pool().destroy(frame);
+        continue;
+      }
+    }
+    _frames.move_frame(i, kept);
+    _frames.update_leader(kept);
+    target = kept++;
+  }
+  _frames.erase(kept, _frames.size());
+  _editsSinceRepackCheck = 0;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::setRepackThreshold(double minFill) {
+  _repackThreshold = minFill;
+}
+
+// checking the fill reads every frame, it is done once per frames.size()
+// edits
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_repack_if_sparse() {
+  if (_repackThreshold == 0 || _versioned ||
+      ++_editsSinceRepackCheck < _frames.size()) {
+    return;
+  }
+  _editsSinceRepackCheck = 0;
+  if (!_shares_any_frame() && memoryUsage().fill() < _repackThreshold) {
+    repack();
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::compact() {
+  // a BasicVersionedTrace keeps frames by their position
+  if (!_versioned && !_shares_any_frame()) {
+    repack();
+  }
+  // compressing a shared frame would keep the frame for its other owners
+  for (std::size_t i = 0; i + 1 < _frames.size(); ++i) {
+    if (!_frames.compressed(i) && !_frames.shared(i)) {
+      _compress(i);
+    }
+  }
+  _frame_pool().trim();
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::setAutoCompact(bool autoCompact) {
+  _autoCompact = autoCompact;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_compress(std::size_t pos) {
+  Frame *frame = _frames[pos];
+  if (frame->embedded()) {
+    // its storage is part of the Trace anyway
+    return;
+  }
+  CompressedTraceFrame *compressed = _frame_pool().create_compressed(*frame);
+  if (compressed != NULL) {
+    _frames.compress(pos, compressed);
+    _frame_pool().destroy(frame);
+  }
+}
+
+// a new tail frame was added, the frame before the previous tail is
+// not written by the append functions any more
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_compact_behind_tail() {
+  if (_autoCompact && _frames.size() >= 3 &&
+      !_frames.compressed(_frames.size() - 3) &&
+      !_frames.shared(_frames.size() - 3)) {
+    _compress(_frames.size() - 3);
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_thaw_frames(std::size_t first,
+                                                   std::size_t last) {
+  for (std::size_t i = first;
+       i < last && (_frames.num_compressed() > 0 || _sharesFrames); ++i) {
+    if (_frames.compressed(i)) {
+      CompressedTraceFrame *compressed = _frames.compressed_frame(i);
+      Frame *frame = _frame_pool().create(_twoState);
+      compressed->decompress(_frames.leader(i), *frame);
+      _frames.replace(i, frame);
+      _frame_pool().destroy(compressed);
+    } else if (_frames.shared(i)) {
+      Frame *shared = _frames[i];
+      Frame *frame = _frame_pool().create(_twoState);
+      frame->assign(*shared);
+      _frames.replace(i, frame);
+      _frame_pool().destroy(shared);
+    }
+  }
+}
+
+// a write at time touches the checkpoints before and after time and the
+// successor of the latter, they are in the frames around the one holding
+// time
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_thaw_around(PackedDeltaTime time) {
+  if (_frames.num_compressed() == 0 && !_sharesFrames) {
+    return;
+  }
+  std::size_t next = _frames.upper_bound(time);
+  _thaw_frames(next < 2 ? 0 : next - 2, std::min(next + 2, _frames.size()));
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::_shares_any_frame() const {
+  if (!_sharesFrames) {
+    return false;
+  }
+  for (std::size_t i = 0; i < _frames.size(); ++i) {
+    if (_frames.shared(i)) {
+      return true;
+    }
+  }
+  // the shared frames were all copied or released by their other owners
+  _sharesFrames = false;
+  return false;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+Bit BasicTrace<FrameSize, Encoding>::_value_before(PackedDeltaTime time) const {
+  TraceFrameCurser curser;
+  search_time(curser, _frames, time);
+  move_backward(curser, _frames);
+  return curser_valid(curser, _frames) ? access_value(curser, _frames)
+                                       : _initvalue;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_erase_range(
+    TraceFrameCurser const &first, TraceFrameCurser const &last) {
+  if (first.frame == last.frame) {
+    if (first.pos != last.pos) {
+      // last is a valid position, the frame keeps an entry
+      _frames[first.frame]->erase(first.pos, last.pos);
+      _frames.update_leader(first.frame);
+    }
+    return;
+  }
+
+  // the frames between the boundary frames are released without reading
+  // them, only the boundary frames are trimmed
+  std::size_t inner = first.frame;
+  if (first.pos > 0) {
+    _frames[first.frame]->truncate(first.pos);
+    ++inner;
+  }
+  for (std::size_t i = inner; i < last.frame; ++i) {
+    destroy_frame(_frames, _frame_pool(), i);
+  }
+  _frames.erase(inner, last.frame);
+
+  if (last.pos > 0) {
+    _frames[inner]->erase(0, last.pos);
+    _frames.update_leader(inner);
+  }
+  if (_frames.empty()) {
+    // a Trace always owns at least one frame
+    _frames.push_back(_frame_pool().create(_twoState));
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_shift_frames(DeltaTime const &oldBase,
+                                                    DeltaTime const &newBase) {
+  assert(newBase < oldBase);
+  const TraceFrameCurser first = first_at_or_after(_frames, oldBase.packed());
+
+  for (std::size_t i = first.frame; i < _frames.size(); ++i) {
+    if (_frames.compressed(i)) {
+      // only the leader of a compressed frame has to move, even if shared
+      const DeltaTime leader = DeltaTime::fromPacked(_frames.leader(i));
+      _frames.move_compressed(i, leader.rebase(oldBase, newBase).packed());
+      continue;
+    }
+    if (_frames.shared(i)) {
+      _thaw_frames(i, i + 1);
+    }
+    Frame *frame = _frames[i];
+    for (unsigned pos = i == first.frame ? first.pos : 0;
+         pos < frame->num_used(); ++pos) {
+      PackedDeltaTime &time = frame->time_at(pos);
+      time = DeltaTime::fromPacked(time).rebase(oldBase, newBase).packed();
+    }
+    _frames.update_leader(i);
+  }
 }
 
 namespace {
 
-void write_eoc(TraceFrameCurser &target, FrameSeq &frames, Time cycle,
-               Bit value) {
-  DeltaTimeFW eoc(endOfCycle(cycle));
+template <class FrameSeq>
+void write_eoc(TraceFrameCurser &target, FrameSeq &frames,
+               typename FrameSeq::Pool &pool, Time cycle, Bit value) {
+  PackedDeltaTime eoc = endOfCycle(cycle).packed();
 
   if (curser_valid(target, frames)) {
-    access_time(target, frames) = eoc;
-    access_value(target, frames) = value;
+    set_time(target, frames, eoc);
+    set_value(target, frames, value);
   } else {
-    insert(target, frames, eoc, value);
+    insert(target, frames, pool, eoc, value);
   }
 
   move_forward(target, frames);
 }
 }
 
-void Trace::removeDeltaCycles() {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::removeDeltaCycles() {
+  _make_general();
+  _thaw_frames(0, _frames.size());
+  _sharesFrames = false;
+
   TraceFrameCurser changePosition = {0, 0};
   TraceFrameCurser currentPosition = {0, 0};
 
@@ -777,10 +1481,12 @@ void Trace::removeDeltaCycles() {
   Bit previousValue = _initvalue;
 
   while (curser_valid(currentPosition, _frames)) {
-    Time cycle = access_time(currentPosition, _frames).get().simcycle();
+    Time cycle =
+        DeltaTime::fromPacked(access_time(currentPosition, _frames)).simcycle();
     if (currentCycle != cycle) {
       if (currentValue != previousValue) {
-        write_eoc(changePosition, _frames, currentCycle, currentValue);
+        write_eoc(changePosition, _frames, _frame_pool(), currentCycle,
+                  currentValue);
         previousValue = currentValue;
       }
     }
@@ -792,49 +1498,159 @@ void Trace::removeDeltaCycles() {
   }
 
   if (currentValue != previousValue) {
-    write_eoc(changePosition, _frames, currentCycle, currentValue);
+    write_eoc(changePosition, _frames, _frame_pool(), currentCycle,
+              currentValue);
   }
 
   if (curser_valid(changePosition, _frames)) {
-    truncate_frames(changePosition, _frames);
+    truncate_frames(changePosition, _frames, _frame_pool());
   }
 }
 
-void Trace::setInitvalue(Bit const &initvalue) { _initvalue = initvalue; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::setInitvalue(Bit const &initvalue) {
+  _check_value(initvalue);
+  _initvalue = initvalue;
+}
 
-boost::intrusive_ptr<Trace> Trace::clone() const {
-  TracePtr theClone(new Trace(_initvalue));
-  TraceFrameCurser a = {0, 0};
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_check_value(Bit const &value) {
+  if (!TraceFrameValues<FrameSize, Encoding>::fits(value)) {
+    throw std::invalid_argument("value does not fit into the Trace encoding");
+  }
+}
 
-  while (curser_valid(a, _frames)) {
-    append_val(theClone->_frames, access_value(a, _frames),
-               access_time(a, _frames));
-    move_forward(a, _frames);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::_check_values(Bit const *values,
+                                                    std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    _check_value(values[i]);
   }
+}
 
-  return theClone;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTrace<FrameSize, Encoding>::check_consistency() const {
+  assert(!_frames.empty() && "a Trace owns at least one frame");
+
+  assert(!_frames.compressed(_frames.size() - 1) &&
+         "the last frame is never compressed");
+
+  PackedDeltaTime previousCloser = 0;
+  std::size_t numCompressed = 0;
+  for (unsigned i = 0; i < _frames.size(); ++i) {
+    Frame const *frame = _frames[i];
+    assert(_frames.size() == 1 || !frame->empty());
+    assert(_frames.leader(i) == frame->leader() && "frame index out of sync");
+    for (unsigned pos = 1; pos < frame->num_used(); ++pos) {
+      assert(frame->time_at(pos - 1) < frame->time_at(pos));
+    }
+    if (i > 0) {
+      assert(previousCloser < frame->leader());
+    }
+    previousCloser = frame->closer();
+    numCompressed += _frames.compressed(i);
+    assert((_frames.compressed(i) || frame->two_state() == isTwoState()) &&
+           "frames of mixed form");
+    assert((!frame->embedded() ||
+            frame == reinterpret_cast<Frame const *>(_embeddedFrame)) &&
+           "embedded frame of another Trace");
+    (void)frame;
+  }
+  assert(numCompressed == _frames.num_compressed() &&
+         "number of compressed frames out of sync");
+  (void)numCompressed;
+  (void)previousCloser;
+
+  if (isTwoState()) {
+    std::vector<Bit> values = computeValues();
+    for (unsigned i = 0; i < values.size(); ++i) {
+      assert((i == 0 || values[i - 1] != values[i]) &&
+             "the values of a two-state Trace alternate");
+      assert(std::count(_twoStateValues, _twoStateValues + _numTwoStateValues,
+                        values[i]) == 1 &&
+             "a two-state Trace has at most two values");
+    }
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+boost::intrusive_ptr<BasicTrace<FrameSize, Encoding> >
+BasicTrace<FrameSize, Encoding>::clone() const {
+  return _share_frames(_frames.size());
 }
 
-boost::intrusive_ptr<Trace> Trace::clone(DeltaTime const &upper_bound) const {
-  TracePtr theClone(new Trace(_initvalue));
-  TraceFrameCurser a = {0, 0};
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+boost::intrusive_ptr<BasicTrace<FrameSize, Encoding> >
+BasicTrace<FrameSize, Encoding>::clone(DeltaTime const &upper_bound) const {
+  const PackedDeltaTime bound = upper_bound.packed();
+  // the frames before the one holding upper_bound end before it
+  const std::size_t last = _frames.upper_bound(bound);
+  if (last == 0) {
+    return _share_frames(0);
+  }
+
+  boost::intrusive_ptr<BasicTrace> theClone;
+  if (_frames[last - 1]->closer() <= bound) {
+    theClone = _share_frames(last);
+    // the last frame is never compressed
+    if (theClone->_frames.compressed(last - 1)) {
+      theClone->_thaw_frames(last - 1, last);
+    }
+    return theClone;
+  }
+
+  theClone = _share_frames(last - 1);
+  Frame const *frame = _frames[last - 1];
+  const unsigned count =
+      std::upper_bound(frame->begin(), frame->end(), bound) - frame->begin();
+  Bit values[FrameSize];
+  frame->decode_bits(0, count, values);
+  Frame *tail = _frame_pool().create(_twoState);
+  tail->assign(frame->begin(), values, count);
+  if (last == 1) {
+    destroy_frame(theClone->_frames, _frame_pool(), 0);
+    theClone->_frames.replace(0, tail);
+  } else {
+    theClone->_frames.push_back(tail);
+  }
+  return theClone;
+}
 
-  while (curser_valid(a, _frames) && access_time(a, _frames) <= upper_bound) {
-    append_val(theClone->_frames, access_value(a, _frames),
-               access_time(a, _frames));
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+boost::intrusive_ptr<BasicTrace<FrameSize, Encoding> >
+BasicTrace<FrameSize, Encoding>::_share_frames(std::size_t count) const {
+  boost::intrusive_ptr<BasicTrace> theClone(
+      new BasicTrace(_initvalue, framePool()));
+  theClone->_copy_form(*this);
+  if (count == 0) {
+    return theClone;
+  }
 
-    move_forward(a, _frames);
+  FrameSeq &frames = theClone->_frames;
+  destroy_frame(frames, _frame_pool(), 0);
+  frames.resize(0);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (!frames.push_back_shared(_frames, i, _frame_pool())) {
+      Frame *copy = _frame_pool().create(_twoState);
+      copy->assign(*_frames[i]);
+      frames.push_back(copy);
+    }
   }
+  _sharesFrames = true;
+  theClone->_sharesFrames = true;
   return theClone;
 }
 
-Trace::const_iterator &Trace::const_iterator::operator++() {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTrace<FrameSize, Encoding>::const_iterator &
+BasicTrace<FrameSize, Encoding>::const_iterator::operator++() {
   move_forward(_curser, _frames);
   return *this;
 }
 
-bool Trace::const_iterator::
-operator==(Trace::const_iterator const &other) const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::const_iterator::
+operator==(const_iterator const &other) const {
   bool sameFrame = (_curser.frame == other._curser.frame);
   bool samePos = (_curser.pos == other._curser.pos);
 
@@ -848,25 +1664,54 @@ operator==(Trace::const_iterator const &other) const {
   return !selfValid && !otherValid;
 }
 
-bool Trace::const_iterator::
-operator!=(const Trace::const_iterator &other) const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTrace<FrameSize, Encoding>::const_iterator::
+operator!=(const_iterator const &other) const {
   return !(*this == other);
 }
 
-Trace::const_iterator::value_type Trace::const_iterator::operator*() const {
-  return value_type(access_time(_curser, _frames),
-                    access_value(_curser, _frames));
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTrace<FrameSize, Encoding>::const_iterator::value_type
+BasicTrace<FrameSize, Encoding>::const_iterator::operator*() const {
+  return value_type(time(), access_value(_curser, _frames));
 }
 
-const DeltaTimeFW &Trace::const_iterator::time() const {
-  return access_time(_curser, _frames);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+DeltaTime BasicTrace<FrameSize, Encoding>::const_iterator::time() const {
+  return DeltaTime::fromPacked(access_time(_curser, _frames));
 }
 
-const Bit &Trace::const_iterator::value() const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+Bit BasicTrace<FrameSize, Encoding>::const_iterator::value() const {
   return access_value(_curser, _frames);
 }
 
-Trace::const_iterator::const_iterator(std::vector<TraceFrame *> const &frames)
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTrace<FrameSize, Encoding>::const_iterator::const_iterator(
+    BasicTraceFrameSeq<FrameSize, Encoding> const &frames)
     : _frames(frames) {}
 
+#define SVT_INSTANTIATE_TRACE(FrameSize, Encoding)                            \
+  template class BasicTrace<FrameSize, Encoding>;                              \
+  template bool compare_traces(BasicTrace<FrameSize, Encoding> const &,       \
+                               BasicTrace<FrameSize, Encoding> const &,       \
+                               boost::function<void(DeltaTime, Bit, Bit)>);   \
+  template bool operator==(BasicTrace<FrameSize, Encoding> const &,           \
+                           BasicTrace<FrameSize, Encoding> const &);
+
+#define SVT_INSTANTIATE_TRACES(FrameSize)                                      \
+  SVT_INSTANTIATE_TRACE(FrameSize, TRACE_VALUES_BYTE)                          \
+  SVT_INSTANTIATE_TRACE(FrameSize, TRACE_VALUES_NIBBLE)
+
+SVT_INSTANTIATE_TRACES(16)
+SVT_INSTANTIATE_TRACES(32)
+SVT_INSTANTIATE_TRACES(64)
+SVT_INSTANTIATE_TRACES(128)
+SVT_INSTANTIATE_TRACES(256)
+SVT_INSTANTIATE_TRACES(512)
+SVT_INSTANTIATE_TRACES(1024)
+
+#undef SVT_INSTANTIATE_TRACES
+#undef SVT_INSTANTIATE_TRACE
+
 } // namespace svt
@@ -1,13 +1,17 @@
 #pragma once
 
-#include <time/DeltaTimeFW.h>
+#include <time/DeltaTime.h>
 #include <trace/Bit.h>
+#include <trace/TraceFramePool.h>
+#include <trace/TraceFrameSeq.h>
+#include <trace/TraceFwd.h>
 
 #include <boost/smart_ptr.hpp>
 #include <boost/function.hpp>
 
+#include <vector>
+
 namespace svt {
-class TraceFrame;
 struct TraceFrameCurser;
 
 /**
@@ -60,67 +64,171 @@ struct TraceFrameCurser {
   unsigned pos;
 };
 
+/**
+ * The memory held by a Trace, see BasicTrace::memoryUsage. A frame shared
+ * with clones is counted by each of its owners.
+ **/
+struct TraceMemoryUsage {
+  std::size_t frameBytes;      // frames that are not compressed
+  std::size_t compressedBytes; // compressed frames
+  std::size_t indexBytes;      // the frame sequence
+  std::size_t overheadBytes;   // the Trace object with its embedded frame
+  std::size_t used;            // checkpoints in the frames not compressed
+  std::size_t capacity;        // checkpoints these frames can hold
+
+  std::size_t bytes() const {
+    return frameBytes + compressedBytes + indexBytes + overheadBytes;
+  }
+  // the part of capacity in use, 1 without an uncompressed frame
+  double fill() const { return capacity == 0 ? 1.0 : double(used) / capacity; }
+};
+
 /**
  * @brief represents trace data for a single signal over time
  *
+ * The checkpoints are stored in frames of FrameSize entries. Small frames
+ * make inserts and splits cheaper, large frames reduce the number of frames
+ * to search and improve sequential access. Trace is the default
+ * BasicTrace<TraceFrameSize>.
+ *
+ * A new Trace is two-state: as long as its checkpoints alternate between two
+ * values, the frames only store those two values and the value of a
+ * checkpoint follows from the parity of its position. Writing a third value,
+ * or any change other than set() with TRACE_MERGE_BOTH and the append
+ * functions, converts the Trace to the general form until it is cleared.
+ *
+ * The first frame of a new Trace is embedded in the Trace object and holds
+ * Frame::EmbeddedSize checkpoints. Most signals change only a few times, a
+ * Trace that never needs more does not allocate at all, not even its pool.
+ *
+ * Values the encoding cannot store, 16 and above for TRACE_VALUES_NIBBLE,
+ * are rejected by std::invalid_argument before the Trace is changed.
  */
-class Trace {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+class BasicTrace {
 public: // typedef
+  typedef BasicTraceFrame<FrameSize, Encoding> Frame;
+  typedef BasicTraceFramePool<FrameSize, Encoding> FramePool;
+  typedef boost::intrusive_ptr<FramePool> FramePoolPtr;
+  typedef BasicTraceFrameSeq<FrameSize, Encoding> FrameSeq;
+
   class const_iterator {
   public:
     const_iterator &operator++();
     bool operator==(const_iterator const &) const;
     bool operator!=(const_iterator const &) const;
 
-    typedef std::pair<DeltaTimeFW const &, Bit const &> value_type;
+    typedef std::pair<DeltaTime, Bit> value_type;
     value_type operator*() const;
 
-    DeltaTimeFW const &time() const;
-    Bit const &value() const;
+    DeltaTime time() const;
+    Bit value() const;
 
   private:
-    const_iterator(std::vector<TraceFrame *> const &);
+    const_iterator(BasicTraceFrameSeq<FrameSize, Encoding> const &);
 
   private:
     TraceFrameCurser _curser;
-    std::vector<TraceFrame *> const &_frames;
+    BasicTraceFrameSeq<FrameSize, Encoding> const &_frames;
 
-    friend class Trace;
+    friend class BasicTrace;
   };
 
 public:
-  Trace(const Bit &initvalue);
-  ~Trace();
+  /**
+   * frames are allocated from pool. If none is given, a new pool is created
+   * with the first frame that is not embedded. clones share the pool of the
+   * original Trace.
+   **/
+  BasicTrace(const Bit &initvalue, FramePoolPtr const &pool = FramePoolPtr());
+  ~BasicTrace();
 
   const_iterator begin() const;
   const_iterator end() const;
+  // the first checkpoint at or after time, end() if there is none
+  const_iterator lowerBound(DeltaTime const &time) const;
 
   bool changed(const DeltaTime &time) const;
 
   DeltaTime checkpoint(const DeltaTime &time) const;
-  std::vector<DeltaTimeFW> computeCheckpoints() const;
+  std::vector<DeltaTime> computeCheckpoints() const;
+  // the values of all checkpoints, in the order of computeCheckpoints
+  std::vector<Bit> computeValues() const;
 
-  DeltaTimeFW firstCheckpoint() const;
-  DeltaTimeFW lastCheckpoint() const;
+  DeltaTime firstCheckpoint() const;
+  DeltaTime lastCheckpoint() const;
 
   bool hasCheckpoints() const;
   std::size_t numberOfCheckpoints() const;
+  // the checkpoints the frames that are not compressed can hold, the
+  // capacity of memoryUsage()
   std::size_t capacity() const;
+  TraceMemoryUsage memoryUsage() const;
+
+  /**
+   * A hash of the initial value and the checkpoints, the same for Traces
+   * with the same checkpoints however they are divided into frames. It is
+   * the sum of the hashes of the frames, which are kept until a frame is
+   * written, so after an edit only the written frames are read again.
+   * Compressed frames are decompressed to hash them.
+   **/
+  uint64_t fingerprint() const;
+
+  // true while the Trace is stored in the two-state form
+  bool isTwoState() const { return _twoState; }
 
-  boost::optional<DeltaTimeFW>
-  prevCheckpoint(DeltaTimeFW const &baseTime) const;
-  boost::optional<DeltaTimeFW>
-  nextCheckpoint(DeltaTimeFW const &baseTime) const;
+  boost::optional<DeltaTime> prevCheckpoint(DeltaTime const &baseTime) const;
+  boost::optional<DeltaTime> nextCheckpoint(DeltaTime const &baseTime) const;
 
-  Bit get(const DeltaTimeFW &t) const;
+  Bit get(const DeltaTime &t) const;
 
-  void set(const Bit &assign, const DeltaTimeFW &time);
+  void set(const Bit &assign, const DeltaTime &time);
 
-  void set(const Bit &assign, const DeltaTimeFW &time,
+  void set(const Bit &assign, const DeltaTime &time,
            TraceChangeMode const changeMode);
 
-  void setRange(Bit const value, DeltaTimeFW const &beginT,
-                DeltaTimeFW const &endT);
+  /**
+   * Same result as set(assign, time), but optimized for the common case of
+   * appending after the last checkpoint. The tail frame is written
+   * directly without searching, and duplicates of the last value are
+   * dropped. Times that are not after the last checkpoint fall back to
+   * set().
+   **/
+  void appendMonotonic(const Bit &assign, const DeltaTime &time);
+
+  /**
+   * Append count values at strictly increasing times, same result as calling
+   * appendMonotonic for each entry. Values equal to their predecessor are
+   * dropped and the remaining entries are copied into the frames in bulk.
+   **/
+  void appendBatch(DeltaTime const *times, Bit const *values,
+                   std::size_t count);
+
+  /**
+   * Run-length version of appendBatch: values[i] starts runLengths[0] + ... +
+   * runLengths[i - 1] simcycles after start and lasts for runLengths[i]
+   * simcycles. A run of length 0 is folded into the next run, which starts
+   * at the same time, so its value never appears in the Trace.
+   **/
+  void appendRuns(DeltaTime const &start, Bit const *values,
+                  Time const *runLengths, std::size_t count);
+
+  /**
+   * Give the Trace value from beginT until endT, the value at endT and
+   * later stays. The checkpoints in between are removed frame by frame, so
+   * the cost does not grow with the length of the range.
+   **/
+  void setRange(Bit const value, DeltaTime const &beginT,
+                DeltaTime const &endT);
+
+  /**
+   * Remove the changes in [beginT, endT), the value before beginT lasts
+   * until endT. With shift the section is cut out instead: the checkpoints
+   * from endT on are rebased to beginT, so the value at beginT is the value
+   * endT had before. Shifting rewrites the times of all later frames.
+   **/
+  void removeRange(DeltaTime const &beginT, DeltaTime const &endT,
+                   bool shift = false);
 
   /**
      removes all values from trace
@@ -132,6 +240,41 @@ public:
     **/
   void removeDeltaCycles();
 
+  /**
+   * Move the checkpoints into as few frames as possible in one pass over
+   * the Trace. Splits and erases leave partly used frames behind, after
+   * repack() every frame is full except for the last one and those before a
+   * compressed or shared frame, which are not touched.
+   **/
+  void repack();
+
+  /**
+   * Repack the Trace once less than minFill of the capacity of its frames
+   * is used, 0 disables it. The fill is checked after as many edits as
+   * there are frames, so the check costs O(1) per edit. A Trace sharing
+   * frames with a clone, or edited through a BasicVersionedTrace, is not
+   * repacked automatically. Disabled by default.
+   **/
+  void setRepackThreshold(double minFill);
+
+  /**
+   * Repack the frames, unless the Trace shares frames with a clone or is
+   * edited through a BasicVersionedTrace, then replace all but the last one by their
+   * CompressedTraceFrame and return the unused memory of the pool to the
+   * heap. Compressed frames are decompressed on demand when they are read
+   * and converted back to frames when they are written.
+   *
+   * Reading a compressed frame changes a cache of the Trace, so a Trace with
+   * compressed frames must not be read from several threads at once.
+   **/
+  void compact();
+
+  /**
+   * Let the append functions compress the frames they leave behind, the
+   * frame before the tail frame stays uncompressed. Disabled by default.
+   **/
+  void setAutoCompact(bool autoCompact);
+
   void add_ref();
   bool release();
 
@@ -142,50 +285,149 @@ public:
    **/
   void check_consistency() const;
 
+  // creates the pool if the Trace has none yet
+  FramePoolPtr const &framePool() const {
+    _frame_pool();
+    return _pool;
+  }
+
   Bit getInitvalue() const { return _initvalue; }
   void setInitvalue(Bit const &initvalue);
 
-  boost::intrusive_ptr<Trace> clone() const;
+  /**
+   * The clone shares the frames of this Trace, a frame is only copied when
+   * one of the Traces owning it writes to it. So a clone costs a pointer per
+   * frame and a snapshot only adds the frames changed after it was taken.
+   **/
+  boost::intrusive_ptr<BasicTrace> clone() const;
   /**
     * copy trace while time <= upper_bound
     **/
-  boost::intrusive_ptr<Trace> clone(DeltaTime const &upper_bound) const;
+  boost::intrusive_ptr<BasicTrace> clone(DeltaTime const &upper_bound) const;
 
 private:
   // disabled
-  Trace(const Trace &other);
-  Trace &operator=(const Trace &other);
+  BasicTrace(const BasicTrace &other);
+  BasicTrace &operator=(const BasicTrace &other);
+
+  // the pool, created on demand
+  FramePool &_frame_pool() const;
+
+  // throw std::invalid_argument if the encoding cannot store the values
+  static void _check_value(Bit const &value);
+  static void _check_values(Bit const *values, std::size_t count);
+
+  // set without the check for repacking, for the writes of a set()
+  void _set(const Bit &assign, const DeltaTime &time,
+            TraceChangeMode const changeMode);
+  void _repack_if_sparse();
 
   void _handle_changes(TraceFrameCurser const &curser,
                        TraceChangeMode const changeMode,
-                       DeltaTimeFW const &atime, Bit curVal);
+                       DeltaTime const &atime, Bit curVal);
+
+  // set with TRACE_MERGE_BOTH for a two-state Trace
+  void _set_two_state(Bit const &assign, PackedDeltaTime time);
+  // false if value would be the third value written to a two-state Trace
+  bool _accept_two_state(Bit const &value);
+  void _make_general();
+  // give this empty Trace the form of other
+  void _copy_form(BasicTrace const &other);
+
+  // compress the frame at pos, unless that does not save memory
+  void _compress(std::size_t pos);
+  void _compact_behind_tail();
+  // decompress the compressed frames in [first, last) and copy the shared
+  // ones, so they can be written
+  void _thaw_frames(std::size_t first, std::size_t last);
+  // thaw the frames a write at time may change
+  void _thaw_around(PackedDeltaTime time);
+  // true if some frame is shared, clears _sharesFrames once none is
+  bool _shares_any_frame() const;
+  // the value before time
+  Bit _value_before(PackedDeltaTime time) const;
+  // remove the checkpoints in [first, last), positions as returned by
+  // first_at_or_after. The frames around both ends must be thawed.
+  void _erase_range(TraceFrameCurser const &first,
+                    TraceFrameCurser const &last);
+  // rebase the checkpoints from oldBase on to newBase, which is earlier
+  void _shift_frames(DeltaTime const &oldBase, DeltaTime const &newBase);
+  // a clone sharing the first count frames
+  boost::intrusive_ptr<BasicTrace> _share_frames(std::size_t count) const;
 
   unsigned _numberOfReferences;
   Bit _initvalue;
+  // the form of all frames, the values written since the Trace is two-state
+  bool _twoState;
+  Bit _twoStateValues[2];
+  unsigned char _numTwoStateValues;
+  bool _autoCompact;
+  double _repackThreshold;
+  std::size_t _editsSinceRepackCheck;
+  // set once frames were shared with a clone, some may still be shared
+  mutable bool _sharesFrames;
+  // edited through a BasicVersionedTrace, which keeps frames by their
+  // position, so the Trace is not repacked
+  bool _versioned;
+  mutable FramePoolPtr _pool;
+  // the storage of the embedded frame, see BasicTraceFrame::embed
+  PackedDeltaTime _embeddedFrame[(Frame::EmbeddedBytes +
+                                  sizeof(PackedDeltaTime) - 1) /
+                                 sizeof(PackedDeltaTime)];
+
+  // reads the frames for its time index
+  template <class> friend class BasicTraceSet;
+  // keeps the frames changed by an edit
+  template <class> friend class BasicVersionedTrace;
+  // compare the frames
+  template <unsigned F, TraceValueEncoding E>
+  friend bool operator==(BasicTrace<F, E> const &a, BasicTrace<F, E> const &b);
+  template <class> friend class BasicTraceDiff;
 
 protected:
-  std::vector<TraceFrame *> _frames;
-
-  /**
-   * compare_traces: similiar to operator==, but additionally logs all changes
-   *in the format
-   *    log(time, aValue, bValue)
-   **/
-  friend bool compare_traces(Trace const &a, Trace const &b,
-                             boost::function<void(DeltaTime, Bit, Bit)> log);
-  friend bool operator==(Trace const &a, Trace const &b);
-  friend bool operator!=(Trace const &a, Trace const &b) { return !(a == b); }
+  BasicTraceFrameSeq<FrameSize, Encoding> _frames;
 };
 
+/**
+ * compare_traces: similiar to operator==, but additionally logs all changes
+ *in the format
+ *    log(time, aValue, bValue)
+ * diff_traces in TraceDiff.h reports the differences as intervals.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool compare_traces(BasicTrace<FrameSize, Encoding> const &a,
+                    BasicTrace<FrameSize, Encoding> const &b,
+                    boost::function<void(DeltaTime, Bit, Bit)> log);
+
+/**
+ * true if a and b have the same value after every checkpoint of either of
+ * them, the initial values only count from the first checkpoint on. Frames
+ * the Traces share are skipped and frames with the same entries compared as
+ * a block, so equal clones compare in a step per frame.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool operator==(BasicTrace<FrameSize, Encoding> const &a,
+                BasicTrace<FrameSize, Encoding> const &b);
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool operator!=(BasicTrace<FrameSize, Encoding> const &a,
+                BasicTrace<FrameSize, Encoding> const &b) {
+  return !(a == b);
+}
+
 /**
  * A memory managed version of Trace.
  * Reference counting is automatically applied
  **/
 typedef boost::intrusive_ptr<Trace> TracePtr;
 
-inline void intrusive_ptr_add_ref(Trace *t) { t->add_ref(); }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+inline void intrusive_ptr_add_ref(BasicTrace<FrameSize, Encoding> *t) {
+  t->add_ref();
+}
 
-inline void intrusive_ptr_release(Trace *t) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+inline void intrusive_ptr_release(BasicTrace<FrameSize, Encoding> *t) {
   if (t->release()) {
     delete t;
   }
@@ -0,0 +1,544 @@
+#include "TraceArchive.h"
+
+#include <trace/Trace.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace svt {
+
+namespace {
+
+const char Magic[8] = {'S', 'V', 'T', 'A', 'R', 'C', 'H', '\0'};
+const uint32_t Version = 1;
+const uint32_t ByteOrder = 0x01020304;
+
+void fail(std::string const &path, char const *what) {
+  throw std::runtime_error(path + ": " + what);
+}
+
+void put_varint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// for the search of the block holding a cycle
+bool starts_after(Time cycle, TraceArchiveBlock const &block) {
+  return cycle < block.beginCycle;
+}
+
+// false if the varint does not end before end
+bool get_varint(uint8_t const *&pos, uint8_t const *end, uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; pos != end && shift < 64; shift += 7) {
+    uint8_t byte = *pos++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Encodes and compresses the columns of the signals [first, last) of a
+ * block, run by one thread of the writer.
+ **/
+template <class Trace> class ColumnEncoder {
+public:
+  typedef typename Trace::const_iterator Iterator;
+
+  ColumnEncoder(std::vector<Trace const *> const &traces,
+                std::vector<Iterator> &iterators, std::vector<Bit> &values,
+                std::vector<TraceArchiveEntry> &table,
+                std::vector<std::vector<uint8_t> > &columns, int level)
+      : _traces(traces), _iterators(iterators), _values(values),
+        _table(table), _columns(columns), _level(level), _failed(false) {}
+
+  void encode(std::size_t first, std::size_t last, Time beginCycle,
+              Time endCycle) {
+    for (std::size_t i = first; i < last && !_failed; ++i) {
+      encode_column(i, beginCycle, endCycle);
+    }
+  }
+
+  bool failed() const { return _failed; }
+
+private:
+  void encode_column(std::size_t i, Time beginCycle, Time endCycle) {
+    Iterator &it = _iterators[i];
+    Iterator const end = _traces[i]->end();
+    TraceArchiveEntry &entry = _table[i];
+    entry = TraceArchiveEntry();
+    entry.initvalue = _values[i];
+
+    _raw.clear();
+    _rawValues.clear();
+    PackedDeltaTime previous = DeltaTime(beginCycle, 0).packed();
+    for (; it != end && it.time().simcycle() < endCycle; ++it) {
+      PackedDeltaTime time = it.time().packed();
+      put_varint(_raw, time - previous);
+      previous = time;
+      _rawValues.push_back(it.value());
+    }
+
+    std::vector<uint8_t> &column = _columns[i];
+    column.clear();
+    if (_rawValues.empty()) {
+      return;
+    }
+    _values[i] = _rawValues.back();
+    _raw.insert(_raw.end(), _rawValues.begin(), _rawValues.end());
+
+    uLongf size = compressBound(_raw.size());
+    column.resize(size);
+    if (_raw.size() > ~uint32_t(0) ||
+        compress2(&column[0], &size, &_raw[0], _raw.size(), _level) != Z_OK) {
+      _failed = true;
+      return;
+    }
+    column.resize(size);
+    entry.compressedSize = size;
+    entry.size = _raw.size();
+    entry.numChanges = _rawValues.size();
+  }
+
+  std::vector<Trace const *> const &_traces;
+  std::vector<Iterator> &_iterators;
+  std::vector<Bit> &_values;
+  std::vector<TraceArchiveEntry> &_table;
+  std::vector<std::vector<uint8_t> > &_columns;
+  int _level;
+  bool _failed;
+
+  std::vector<uint8_t> _raw;
+  std::vector<Bit> _rawValues;
+};
+
+/**
+ * The threads running all but the first encoder, for all blocks of a
+ * write. The threads are stopped and joined when it is destroyed, also if
+ * the write fails.
+ **/
+template <class Encoder> class EncoderThreads {
+public:
+  EncoderThreads(std::vector<Encoder> &encoders, std::size_t numSignals)
+      : _encoders(encoders), _numSignals(numSignals), _block(0), _pending(0),
+        _stop(false), _begin(0), _end(0) {
+    try {
+      for (unsigned t = 1; t < _encoders.size(); ++t) {
+        _threads.push_back(std::thread(&EncoderThreads::work, this, t));
+      }
+    } catch (...) {
+      stop();
+      throw;
+    }
+  }
+
+  ~EncoderThreads() { stop(); }
+
+  // encode the columns of the block [begin, end), the first range of
+  // signals is encoded by the calling thread
+  void encode(Time begin, Time end) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _begin = begin;
+      _end = end;
+      _pending = _threads.size();
+      ++_block;
+    }
+    _started.notify_all();
+
+    std::exception_ptr error;
+    try {
+      _encoders[0].encode(0, range_end(0), begin, end);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_pending > 0) {
+      _finished.wait(lock);
+    }
+    if (!error) {
+      error = _error;
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  // disabled
+  EncoderThreads(const EncoderThreads &other);
+  EncoderThreads &operator=(const EncoderThreads &other);
+
+  std::size_t range_end(unsigned t) const {
+    return (t + 1) * _numSignals / _encoders.size();
+  }
+
+  void work(unsigned t) {
+    uint64_t done = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+      while (_block == done && !_stop) {
+        _started.wait(lock);
+      }
+      if (_stop) {
+        return;
+      }
+      done = _block;
+      const Time begin = _begin;
+      const Time end = _end;
+      lock.unlock();
+      try {
+        _encoders[t].encode(t * _numSignals / _encoders.size(), range_end(t),
+                            begin, end);
+      } catch (...) {
+        lock.lock();
+        _error = std::current_exception();
+        lock.unlock();
+      }
+      lock.lock();
+      if (--_pending == 0) {
+        _finished.notify_one();
+      }
+    }
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _started.notify_all();
+    for (std::size_t t = 0; t < _threads.size(); ++t) {
+      _threads[t].join();
+    }
+    _threads.clear();
+  }
+
+  std::vector<Encoder> &_encoders;
+  const std::size_t _numSignals;
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _started;
+  std::condition_variable _finished;
+  // the number of blocks started, the threads still encoding the last one
+  uint64_t _block;
+  std::size_t _pending;
+  bool _stop;
+  Time _begin;
+  Time _end;
+  std::exception_ptr _error;
+};
+
+} // namespace
+
+template <class Trace>
+const Time BasicTraceArchiveWriter<Trace>::DefaultBlockCycles;
+
+template <class Trace>
+BasicTraceArchiveWriter<Trace>::BasicTraceArchiveWriter(
+    std::string const &path, Time blockCycles, unsigned numThreads, int level)
+    : _path(path), _out(path.c_str(), std::ios::binary | std::ios::trunc),
+      _offset(0), _blockCycles(std::max<Time>(blockCycles, 1)),
+      _numThreads(numThreads), _level(level) {
+  if (!_out) {
+    fail(path, "cannot create trace archive");
+  }
+  if (_numThreads == 0) {
+    _numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+}
+
+template <class Trace>
+void BasicTraceArchiveWriter<Trace>::addSignal(std::string const &name,
+                                               Trace const &trace) {
+  _names.push_back(name);
+  _traces.push_back(&trace);
+}
+
+template <class Trace>
+void BasicTraceArchiveWriter<Trace>::put(void const *data, std::size_t bytes) {
+  _out.write(static_cast<char const *>(data), bytes);
+  if (!_out) {
+    fail(_path, "cannot write trace archive");
+  }
+  _offset += bytes;
+}
+
+template <class Trace> void BasicTraceArchiveWriter<Trace>::write() {
+  typedef ColumnEncoder<Trace> Encoder;
+  typedef typename Encoder::Iterator Iterator;
+
+  const std::size_t numSignals = _traces.size();
+  TraceArchiveHeader header = TraceArchiveHeader();
+  // written again at the end, an unfinished archive has no valid magic
+  put(&header, sizeof(header));
+
+  std::vector<Iterator> iterators;
+  std::vector<Bit> values;
+  iterators.reserve(numSignals);
+  for (std::size_t i = 0; i < numSignals; ++i) {
+    Trace const &trace = *_traces[i];
+    iterators.push_back(trace.begin());
+    values.push_back(trace.getInitvalue());
+    if (trace.hasCheckpoints()) {
+      header.endCycle = std::max<uint64_t>(
+          header.endCycle, trace.lastCheckpoint().simcycle() + 1);
+    }
+  }
+
+  std::vector<TraceArchiveEntry> table(numSignals);
+  std::vector<std::vector<uint8_t> > columns(numSignals);
+  std::vector<TraceArchiveBlock> index;
+  const unsigned numThreads = static_cast<unsigned>(
+      std::max<std::size_t>(std::min<std::size_t>(_numThreads, numSignals), 1));
+  std::vector<Encoder> encoders(
+      numThreads, Encoder(_traces, iterators, values, table, columns, _level));
+  EncoderThreads<Encoder> threads(encoders, numSignals);
+
+  Time begin = 0;
+  while (begin < header.endCycle) {
+    const Time end = begin + _blockCycles;
+    threads.encode(begin, end);
+
+    for (unsigned t = 0; t < numThreads; ++t) {
+      if (encoders[t].failed()) {
+        fail(_path, "cannot compress trace archive block");
+      }
+    }
+    bool changes = false;
+    for (std::size_t i = 0; i < numSignals; ++i) {
+      if (!columns[i].empty()) {
+        table[i].offset = _offset;
+        put(&columns[i][0], columns[i].size());
+        changes = true;
+      }
+    }
+    if (changes) {
+      TraceArchiveBlock block = {begin, _offset};
+      index.push_back(block);
+      put(&table[0], numSignals * sizeof(TraceArchiveEntry));
+    }
+
+    // skip the blocks without changes
+    begin = header.endCycle;
+    for (std::size_t i = 0; i < numSignals; ++i) {
+      if (iterators[i] != _traces[i]->end()) {
+        Time next = iterators[i].time().simcycle();
+        begin = std::min(begin, next - next % _blockCycles);
+      }
+    }
+  }
+
+  header.indexOffset = _offset;
+  if (!index.empty()) {
+    put(&index[0], index.size() * sizeof(TraceArchiveBlock));
+  }
+  header.signalsOffset = _offset;
+  for (std::size_t i = 0; i < numSignals; ++i) {
+    uint32_t size = _names[i].size();
+    put(&size, sizeof(size));
+    put(_names[i].data(), size);
+    Bit initvalue = _traces[i]->getInitvalue();
+    put(&initvalue, sizeof(initvalue));
+  }
+
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.byteOrder = ByteOrder;
+  header.blockCycles = _blockCycles;
+  header.numSignals = numSignals;
+  header.numBlocks = index.size();
+  _out.seekp(0);
+  put(&header, sizeof(header));
+  _out.close();
+  if (!_out) {
+    fail(_path, "cannot write trace archive");
+  }
+}
+
+TraceArchive::TraceArchive(std::string const &path)
+    : _path(path), _in(path.c_str(), std::ios::binary), _bytes(0) {
+  if (!_in) {
+    fail("cannot open trace archive");
+  }
+  _in.seekg(0, std::ios::end);
+  _bytes = _in.tellg();
+
+  if (_bytes < sizeof(_header)) {
+    fail("not a trace archive");
+  }
+  get(0, &_header, sizeof(_header));
+  if (std::memcmp(_header.magic, Magic, sizeof(Magic)) != 0) {
+    fail("not a trace archive");
+  }
+  if (_header.byteOrder != ByteOrder) {
+    fail("trace archive written with another byte order");
+  }
+  if (_header.version != Version) {
+    fail("unsupported trace archive version");
+  }
+  if (_header.indexOffset > _bytes ||
+      _header.numBlocks >
+          (_bytes - _header.indexOffset) / sizeof(TraceArchiveBlock)) {
+    fail("corrupt trace archive header");
+  }
+
+  _blocks.resize(_header.numBlocks);
+  if (!_blocks.empty()) {
+    get(_header.indexOffset, &_blocks[0],
+        _blocks.size() * sizeof(TraceArchiveBlock));
+  }
+  for (std::size_t b = 0; b < _blocks.size(); ++b) {
+    // read() searches the blocks by their beginCycle
+    if ((b > 0 && _blocks[b].beginCycle <= _blocks[b - 1].beginCycle) ||
+        _blocks[b].tableOffset > _bytes ||
+        _header.numSignals > (_bytes - _blocks[b].tableOffset) /
+                                 sizeof(TraceArchiveEntry)) {
+      fail("corrupt trace archive index");
+    }
+  }
+
+  uint64_t offset = _header.signalsOffset;
+  for (uint64_t i = 0; i < _header.numSignals; ++i) {
+    uint32_t size = 0;
+    get(offset, &size, sizeof(size));
+    offset += sizeof(size);
+    if (size > _bytes - offset) {
+      fail("corrupt trace archive signals");
+    }
+    std::string name(size, '\0');
+    get(offset, &name[0], size);
+    offset += size;
+    _names.push_back(name);
+
+    Bit initvalue = 0;
+    get(offset, &initvalue, sizeof(initvalue));
+    offset += sizeof(initvalue);
+    _initvalues.push_back(initvalue);
+  }
+}
+
+void TraceArchive::fail(char const *what) const { svt::fail(_path, what); }
+
+void TraceArchive::get(uint64_t offset, void *data, std::size_t bytes) {
+  if (offset > _bytes || bytes > _bytes - offset) {
+    fail("truncated trace archive");
+  }
+  _in.seekg(offset);
+  _in.read(static_cast<char *>(data), bytes);
+  if (!_in) {
+    fail("cannot read trace archive");
+  }
+}
+
+TraceArchiveEntry TraceArchive::entry(std::size_t block, std::size_t signal) {
+  TraceArchiveEntry entry;
+  get(_blocks[block].tableOffset + signal * sizeof(TraceArchiveEntry), &entry,
+      sizeof(entry));
+  return entry;
+}
+
+void TraceArchive::column(TraceArchiveEntry const &entry, Time beginCycle,
+                          std::vector<PackedDeltaTime> &times,
+                          std::vector<Bit> &values) {
+  times.clear();
+  values.clear();
+  if (entry.numChanges == 0) {
+    return;
+  }
+
+  if (entry.compressedSize == 0) {
+    fail("corrupt trace archive column");
+  }
+  _compressed.resize(entry.compressedSize);
+  get(entry.offset, &_compressed[0], _compressed.size());
+  _column.resize(entry.size);
+  uLongf size = entry.size;
+  if (entry.size < entry.numChanges ||
+      uncompress(&_column[0], &size, &_compressed[0], _compressed.size()) !=
+          Z_OK ||
+      size != entry.size) {
+    fail("corrupt trace archive column");
+  }
+
+  uint8_t const *pos = &_column[0];
+  uint8_t const *const valuesBegin = pos + size - entry.numChanges;
+  PackedDeltaTime time = DeltaTime(beginCycle, 0).packed();
+  for (uint32_t i = 0; i < entry.numChanges; ++i) {
+    uint64_t distance;
+    if (!get_varint(pos, valuesBegin, distance)) {
+      fail("corrupt trace archive column");
+    }
+    time += distance;
+    times.push_back(time);
+  }
+  if (pos != valuesBegin) {
+    fail("corrupt trace archive column");
+  }
+  values.assign(valuesBegin, valuesBegin + entry.numChanges);
+}
+
+template <class Trace>
+void TraceArchive::read(std::vector<std::size_t> const &signals, Time begin,
+                        Time end, std::vector<Trace *> const &traces) {
+  assert(signals.size() == traces.size());
+
+  // the last block starting at or before begin, its entries hold the value
+  // before the first change of the window
+  std::size_t first =
+      std::upper_bound(_blocks.begin(), _blocks.end(), begin, starts_after) -
+      _blocks.begin();
+  first = first == 0 ? 0 : first - 1;
+
+  std::vector<PackedDeltaTime> times;
+  std::vector<Bit> values;
+  for (std::size_t k = 0; k < signals.size(); ++k) {
+    assert(signals[k] < numSignals());
+    Trace &trace = *traces[k];
+    trace.setInitvalue(_initvalues[signals[k]]);
+
+    for (std::size_t b = first;
+         b < _blocks.size() && _blocks[b].beginCycle < end; ++b) {
+      TraceArchiveEntry e = entry(b, signals[k]);
+      if (b == first) {
+        trace.setInitvalue(e.initvalue);
+      }
+      column(e, _blocks[b].beginCycle, times, values);
+      for (std::size_t i = 0; i < times.size(); ++i) {
+        DeltaTime time = DeltaTime::fromPacked(times[i]);
+        if (time.simcycle() < begin) {
+          trace.setInitvalue(values[i]);
+        } else if (time.simcycle() < end) {
+          trace.appendMonotonic(values[i], time);
+        }
+      }
+    }
+  }
+}
+
+template class BasicTraceArchiveWriter<Trace>;
+template class BasicTraceArchiveWriter<NibbleTrace>;
+
+template void TraceArchive::read(std::vector<std::size_t> const &signals,
+                                 Time begin, Time end,
+                                 std::vector<Trace *> const &traces);
+template void TraceArchive::read(std::vector<std::size_t> const &signals,
+                                 Time begin, Time end,
+                                 std::vector<NibbleTrace *> const &traces);
+
+} // namespace svt
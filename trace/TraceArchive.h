@@ -0,0 +1,160 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+#include <trace/TraceFwd.h>
+
+#include <stdint.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace svt {
+
+/**
+ * The layout of a trace archive, in the byte order of the writing host.
+ *
+ *   TraceArchiveHeader
+ *   for every block of blockCycles simcycles with changes:
+ *     the compressed column of every signal with changes in the block
+ *     TraceArchiveEntry table[numSignals]
+ *   TraceArchiveBlock index[numBlocks]
+ *   for every signal: the length of its name as uint32_t, the name and
+ *     the initvalue
+ *
+ * A column holds the changes of a signal inside its block: the distances
+ * between their packed times as LEB128 varints, the first one relative to
+ * the start of the block, followed by their values. It is compressed with
+ * zlib.
+ **/
+struct TraceArchiveHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t blockCycles;
+  uint64_t endCycle;
+  uint64_t numSignals;
+  uint64_t numBlocks;
+  uint64_t indexOffset;
+  uint64_t signalsOffset;
+};
+
+struct TraceArchiveBlock {
+  uint64_t beginCycle;
+  uint64_t tableOffset;
+};
+
+struct TraceArchiveEntry {
+  uint64_t offset;
+  uint32_t compressedSize;
+  uint32_t size;
+  uint32_t numChanges;
+  // the value before the first change of the block
+  Bit initvalue;
+  uint8_t reserved[3];
+};
+
+/**
+ * Writes a collection of Traces into a block compressed archive, see
+ * TraceArchive. The columns of a block are encoded and compressed by
+ * numThreads threads in parallel, which are started once per write(). The
+ * blocks are written one after the other, only the columns of one block are
+ * kept in memory.
+ *
+ * Errors are reported by std::runtime_error.
+ **/
+template <class Trace> class BasicTraceArchiveWriter {
+public:
+  static const Time DefaultBlockCycles = 1 << 16;
+
+  /**
+   * numThreads 0 uses one thread per core, level is the zlib compression
+   * level.
+   **/
+  explicit BasicTraceArchiveWriter(std::string const &path,
+                                   Time blockCycles = DefaultBlockCycles,
+                                   unsigned numThreads = 0, int level = 1);
+
+  /**
+   * The Trace must not change until write() finished. The Traces are read
+   * by several threads, a Trace with compressed frames must not be added
+   * twice.
+   **/
+  void addSignal(std::string const &name, Trace const &trace);
+
+  // write all signals and close the archive
+  void write();
+
+private:
+  // disabled
+  BasicTraceArchiveWriter(const BasicTraceArchiveWriter &other);
+  BasicTraceArchiveWriter &operator=(const BasicTraceArchiveWriter &other);
+
+  void put(void const *data, std::size_t bytes);
+
+  std::string _path;
+  std::ofstream _out;
+  uint64_t _offset;
+  Time _blockCycles;
+  unsigned _numThreads;
+  int _level;
+  std::vector<std::string> _names;
+  std::vector<Trace const *> _traces;
+};
+
+typedef BasicTraceArchiveWriter<Trace> TraceArchiveWriter;
+typedef BasicTraceArchiveWriter<NibbleTrace> NibbleTraceArchiveWriter;
+
+/**
+ * Reads windows of a trace archive written by BasicTraceArchiveWriter.
+ *
+ * Opening reads the header, the block index and the signals. read() then
+ * only reads the table entries and columns of the requested signals in the
+ * blocks overlapping the requested window.
+ *
+ * Errors are reported by std::runtime_error.
+ **/
+class TraceArchive {
+public:
+  explicit TraceArchive(std::string const &path);
+
+  std::size_t numSignals() const { return _names.size(); }
+  std::vector<std::string> const &names() const { return _names; }
+
+  // the simcycle after the last change of all signals
+  Time endCycle() const { return _header.endCycle; }
+
+  /**
+   * The changes of signals[i] in the simcycles [begin, end) are appended to
+   * traces[i], the value before begin becomes its initvalue. The Traces
+   * should be empty.
+   **/
+  template <class Trace>
+  void read(std::vector<std::size_t> const &signals, Time begin, Time end,
+            std::vector<Trace *> const &traces);
+
+private:
+  // disabled
+  TraceArchive(const TraceArchive &other);
+  TraceArchive &operator=(const TraceArchive &other);
+
+  void fail(char const *what) const;
+  void get(uint64_t offset, void *data, std::size_t bytes);
+  TraceArchiveEntry entry(std::size_t block, std::size_t signal);
+  // the times and values of the changes in the column of entry
+  void column(TraceArchiveEntry const &entry, Time beginCycle,
+              std::vector<PackedDeltaTime> &times, std::vector<Bit> &values);
+
+  std::string _path;
+  std::ifstream _in;
+  uint64_t _bytes;
+  TraceArchiveHeader _header;
+  std::vector<TraceArchiveBlock> _blocks;
+  std::vector<std::string> _names;
+  std::vector<Bit> _initvalues;
+  std::vector<uint8_t> _compressed;
+  std::vector<uint8_t> _column;
+};
+
+} // namespace svt
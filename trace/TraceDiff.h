@@ -0,0 +1,265 @@
+#pragma once
+
+#include <trace/Trace.h>
+#include <trace/TraceFrameImpl.h>
+
+#include <cstring>
+#include <limits>
+
+namespace svt {
+
+/**
+ * An interval [begin, end) in which two Traces have the different values a
+ * and b. A difference lasting to the last checkpoint of both ends at
+ * TraceDifference::endOfTime().
+ **/
+struct TraceDifference {
+  DeltaTime begin;
+  DeltaTime end;
+  Bit a;
+  Bit b;
+
+  static DeltaTime endOfTime() {
+    return DeltaTime(DeltaTime::MaxSimTime, DeltaTime::MaxDeltaTime);
+  }
+};
+
+/**
+ * Walks the checkpoints of a Trace frame by frame. The entries of the
+ * current frame are decoded into arrays when they are read one by one, a
+ * frame can also be passed over as a whole.
+ **/
+template <class FrameSeq> class TraceWalk {
+public:
+  typedef typename FrameSeq::Frame Frame;
+
+  TraceWalk(FrameSeq const &frames, Bit initvalue)
+      : _frames(frames), _frame(0), _pos(0), _used(0), _decoded(false),
+        _times(NULL), _value(initvalue) {
+    load();
+  }
+
+  bool at_end() const { return _frame == _frames.size(); }
+  bool at_frame_start() const { return _pos == 0; }
+
+  // the value after the checkpoints passed so far
+  Bit value() const { return _value; }
+
+  // the current frame, which is not empty
+  std::size_t frame() const { return _frame; }
+  FrameSeq const &frames() const { return _frames; }
+  unsigned num_used() const { return _used; }
+
+  void decode() {
+    if (!_decoded) {
+      Frame const *frame = _frames[_frame];
+      _times = frame->begin();
+      frame->decode_bits(0, _used, _values);
+      _decoded = true;
+    }
+  }
+  PackedDeltaTime const *times() const { return _times; }
+  Bit const *values() const { return _values; }
+
+  // the current checkpoint, after decode()
+  PackedDeltaTime time() const { return _times[_pos]; }
+  void advance() {
+    _value = _values[_pos];
+    if (++_pos == _used) {
+      ++_frame;
+      load();
+    }
+  }
+
+  // pass over the current frame, at_frame_start() must be true
+  void skip_frame() {
+    _value = _decoded ? _values[_used - 1] : _frames[_frame]->bit_at(_used - 1);
+    ++_frame;
+    load();
+  }
+
+  // true if all remaining checkpoints have the value
+  bool rest_is(Bit value) {
+    for (; !at_end(); ++_frame, load()) {
+      decode();
+      for (; _pos < _used; ++_pos) {
+        if (_values[_pos] != value) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  // start at the first entry of the next frame that is not empty
+  void load() {
+    while (_frame < _frames.size() && _frames.num_used(_frame) == 0) {
+      ++_frame;
+    }
+    _pos = 0;
+    _used = at_end() ? 0 : _frames.num_used(_frame);
+    _decoded = false;
+  }
+
+  FrameSeq const &_frames;
+  std::size_t _frame;
+  unsigned _pos;
+  unsigned _used;
+  bool _decoded;
+  PackedDeltaTime const *_times;
+  Bit _value;
+  Bit _values[Frame::max_size];
+};
+
+/**
+ * true if the current frames of a and b, both at their start, hold the same
+ * entries. A frame shared by both is not read, the others are compared as
+ * blocks.
+ **/
+template <class FrameSeq>
+bool same_entries(TraceWalk<FrameSeq> &a, TraceWalk<FrameSeq> &b) {
+  const unsigned used = a.num_used();
+  if (used != b.num_used()) {
+    return false;
+  }
+  if (a.frames().same_frame(a.frame(), b.frames(), b.frame())) {
+    return true;
+  }
+  a.decode();
+  b.decode();
+  return std::memcmp(a.times(), b.times(), used * sizeof(PackedDeltaTime)) ==
+             0 &&
+         std::memcmp(a.values(), b.values(), used * sizeof(Bit)) == 0;
+}
+
+/**
+ * The differences of two Traces as intervals, in time order.
+ *
+ * Like compare_traces the values are compared after every checkpoint of
+ * either Trace, the initial values only count from the first checkpoint on.
+ * An interval ends at the first checkpoint changing one of its two values.
+ * Frames holding the same entries in both Traces are passed over as a
+ * whole, see operator==.
+ *
+ * The differences are reported to a sink, any callable taking a
+ * TraceDifference const &, which is inlined into the walk, or into a buffer
+ * of the caller. Both can stop after a number of differences and continue
+ * with the next call. The Traces must not change while they are compared.
+ **/
+template <class Trace> class BasicTraceDiff {
+public:
+  BasicTraceDiff(Trace const &a, Trace const &b)
+      : _a(a._frames, a._initvalue), _b(b._frames, b._initvalue),
+        _open(false) {}
+
+  // true once all differences have been reported
+  bool done() const { return _a.at_end() && _b.at_end() && !_open; }
+
+  /**
+   * pass the next differences to sink, at most maxDifferences of them.
+   * Returns the number passed, which is less only at the end.
+   **/
+  template <class Sink>
+  std::size_t run(Sink &sink, std::size_t maxDifferences =
+                                  std::numeric_limits<std::size_t>::max());
+
+  // write the next differences to out, at most count of them
+  std::size_t next(TraceDifference *out, std::size_t count) {
+    BufferSink sink = {out};
+    return run(sink, count);
+  }
+
+private:
+  typedef typename Trace::FrameSeq FrameSeq;
+
+  struct BufferSink {
+    TraceDifference *out;
+    void operator()(TraceDifference const &difference) {
+      *out++ = difference;
+    }
+  };
+
+  TraceWalk<FrameSeq> _a;
+  TraceWalk<FrameSeq> _b;
+  // the difference up to the current checkpoints, if they differ
+  bool _open;
+  TraceDifference _current;
+};
+
+template <class Trace>
+template <class Sink>
+std::size_t BasicTraceDiff<Trace>::run(Sink &sink,
+                                       std::size_t maxDifferences) {
+  std::size_t reported = 0;
+  while (reported < maxDifferences) {
+    if (_a.at_end() && _b.at_end()) {
+      if (_open) {
+        _current.end = TraceDifference::endOfTime();
+        sink(_current);
+        _open = false;
+        ++reported;
+      }
+      break;
+    }
+
+    PackedDeltaTime time;
+    if (!_a.at_end() && !_b.at_end() && _a.at_frame_start() &&
+        _b.at_frame_start() && same_entries(_a, _b)) {
+      // the values agree from the first entry to the end of the frames
+      time = _a.frames().leader(_a.frame());
+      _a.skip_frame();
+      _b.skip_frame();
+    } else {
+      if (!_a.at_end()) {
+        _a.decode();
+      }
+      if (!_b.at_end()) {
+        _b.decode();
+      }
+      const PackedDeltaTime timeA =
+          _a.at_end() ? ~PackedDeltaTime(0) : _a.time();
+      const PackedDeltaTime timeB =
+          _b.at_end() ? ~PackedDeltaTime(0) : _b.time();
+      time = timeA < timeB ? timeA : timeB;
+      if (timeA == time) {
+        _a.advance();
+      }
+      if (timeB == time) {
+        _b.advance();
+      }
+    }
+
+    const Bit valueA = _a.value();
+    const Bit valueB = _b.value();
+    if (_open && (valueA != _current.a || valueB != _current.b)) {
+      _current.end = DeltaTime::fromPacked(time);
+      sink(_current);
+      _open = false;
+      ++reported;
+    }
+    if (!_open && valueA != valueB) {
+      _current.begin = DeltaTime::fromPacked(time);
+      _current.a = valueA;
+      _current.b = valueB;
+      _open = true;
+    }
+  }
+  return reported;
+}
+
+/**
+ * pass the differences of a and b to sink, at most maxDifferences. Returns
+ * the number of differences passed.
+ **/
+template <class Trace, class Sink>
+std::size_t diff_traces(Trace const &a, Trace const &b, Sink sink,
+                        std::size_t maxDifferences =
+                            std::numeric_limits<std::size_t>::max()) {
+  BasicTraceDiff<Trace> diff(a, b);
+  return diff.run(sink, maxDifferences);
+}
+
+typedef BasicTraceDiff<Trace> TraceDiff;
+
+} // namespace svt
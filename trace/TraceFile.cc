@@ -0,0 +1,211 @@
+#include "TraceFile.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace svt {
+
+namespace {
+
+const char Magic[8] = {'S', 'V', 'T', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t Version = 1;
+const uint32_t ByteOrder = 0x01020304;
+
+void fail(std::string const &path, char const *what) {
+  throw std::runtime_error(path + ": " + what);
+}
+
+// maps the whole file read-only, returns its size in bytes
+char const *map_file(std::string const &path, std::size_t &bytes) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    fail(path, "cannot open trace file");
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    fail(path, "not a trace file");
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    fail(path, "cannot map trace file");
+  }
+  // the view keeps the mapping alive
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (data == NULL) {
+    fail(path, "cannot map trace file");
+  }
+  bytes = static_cast<std::size_t>(size.QuadPart);
+  return static_cast<char const *>(data);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fail(path, "cannot open trace file");
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    fail(path, "not a trace file");
+  }
+  // shared, so all processes reading the file use the same pages
+  void *data = ::mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    fail(path, "cannot map trace file");
+  }
+  bytes = static_cast<std::size_t>(st.st_size);
+  return static_cast<char const *>(data);
+#endif
+}
+
+void unmap_file(char const *data, std::size_t bytes) {
+#ifdef _WIN32
+  (void)bytes;
+  UnmapViewOfFile(data);
+#else
+  ::munmap(const_cast<char *>(data), bytes);
+#endif
+}
+
+// whether the array [offset, offset + count * size) lies in the file
+bool in_file(uint64_t offset, uint64_t count, uint64_t size, uint64_t bytes) {
+  return offset <= bytes && count <= (bytes - offset) / size;
+}
+
+} // namespace
+
+TraceFileWriter::TraceFileWriter(std::string const &path)
+    : _path(path), _out(path.c_str(), std::ios::binary | std::ios::trunc),
+      _offset(0) {
+  if (!_out) {
+    fail(path, "cannot create trace file");
+  }
+
+  // written again by close(), an unfinished file has no valid magic
+  TraceFileHeader header = TraceFileHeader();
+  write(&header, sizeof(header));
+}
+
+TraceFileWriter::~TraceFileWriter() {
+  if (_out.is_open()) {
+    try {
+      close();
+    } catch (std::runtime_error const &) {
+    }
+  }
+}
+
+void TraceFileWriter::write(void const *data, std::size_t bytes) {
+  assert(_out.is_open() && "trace file already closed");
+  _out.write(static_cast<char const *>(data), bytes);
+  if (!_out) {
+    fail(_path, "cannot write trace file");
+  }
+  _offset += bytes;
+}
+
+void TraceFileWriter::align() {
+  static const char padding[sizeof(PackedDeltaTime)] = {0};
+  write(padding, (sizeof(PackedDeltaTime) - _offset % sizeof(PackedDeltaTime)) %
+                     sizeof(PackedDeltaTime));
+}
+
+void TraceFileWriter::close() {
+  align();
+  TraceFileHeader header = TraceFileHeader();
+  header.version = Version;
+  header.byteOrder = ByteOrder;
+  header.frameSize = TraceFrameSize;
+  header.numTraces = _entries.size();
+  header.directoryOffset = _offset;
+  write(_entries.data(), _entries.size() * sizeof(TraceFileEntry));
+
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  _out.seekp(0);
+  write(&header, sizeof(header));
+  _out.close();
+  if (!_out) {
+    fail(_path, "cannot write trace file");
+  }
+}
+
+TraceFile::TraceFile(std::string const &path)
+    : _data(map_file(path, _bytes)),
+      _header(reinterpret_cast<TraceFileHeader const *>(_data)),
+      _directory(NULL) {
+  try {
+    _directory = validate(path);
+  } catch (...) {
+    unmap_file(_data, _bytes);
+    throw;
+  }
+}
+
+TraceFile::~TraceFile() { unmap_file(_data, _bytes); }
+
+TraceFileEntry const *TraceFile::validate(std::string const &path) const {
+  if (_bytes < sizeof(TraceFileHeader) ||
+      std::memcmp(_header->magic, Magic, sizeof(Magic)) != 0) {
+    fail(path, "not a trace file");
+  }
+  if (_header->byteOrder != ByteOrder) {
+    fail(path, "trace file written with another byte order");
+  }
+  if (_header->version != Version) {
+    fail(path, "unsupported trace file version");
+  }
+  if (_header->frameSize == 0 ||
+      _header->directoryOffset % sizeof(PackedDeltaTime) != 0 ||
+      !in_file(_header->directoryOffset, _header->numTraces,
+               sizeof(TraceFileEntry), _bytes)) {
+    fail(path, "corrupt trace file header");
+  }
+
+  TraceFileEntry const *directory = reinterpret_cast<TraceFileEntry const *>(
+      _data + _header->directoryOffset);
+  for (uint64_t i = 0; i < _header->numTraces; ++i) {
+    TraceFileEntry const &entry = directory[i];
+    uint64_t frames =
+        (entry.numCheckpoints + _header->frameSize - 1) / _header->frameSize;
+    if (entry.timesOffset % sizeof(PackedDeltaTime) != 0 ||
+        entry.leadersOffset % sizeof(PackedDeltaTime) != 0 ||
+        !in_file(entry.timesOffset, entry.numCheckpoints,
+                 sizeof(PackedDeltaTime), _bytes) ||
+        !in_file(entry.leadersOffset, frames, sizeof(PackedDeltaTime),
+                 _bytes) ||
+        !in_file(entry.valuesOffset, entry.numCheckpoints, sizeof(Bit),
+                 _bytes)) {
+      fail(path, "corrupt trace file directory");
+    }
+  }
+  return directory;
+}
+
+std::size_t TraceFile::size() const { return _header->numTraces; }
+
+TraceView TraceFile::view(std::size_t index) const {
+  assert(index < size());
+  TraceFileEntry const &entry = _directory[index];
+  return TraceView(
+      reinterpret_cast<PackedDeltaTime const *>(_data + entry.timesOffset),
+      reinterpret_cast<Bit const *>(_data + entry.valuesOffset),
+      entry.numCheckpoints,
+      reinterpret_cast<PackedDeltaTime const *>(_data + entry.leadersOffset),
+      _header->frameSize, entry.initvalue);
+}
+
+} // namespace svt
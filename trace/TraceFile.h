@@ -0,0 +1,160 @@
+#pragma once
+
+#include <trace/Trace.h>
+#include <trace/TraceView.h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace svt {
+
+/**
+ * The layout of a trace file. All fields are stored in the byte order of
+ * the writing host, a reader with another byte order rejects the file.
+ *
+ *   TraceFileHeader
+ *   for every trace, each array aligned to 8 bytes:
+ *     PackedDeltaTime times[numCheckpoints]
+ *     PackedDeltaTime leaders[frames]   the time of every frameSize-th entry
+ *     Bit values[numCheckpoints]
+ *   TraceFileEntry directory[numTraces]
+ *
+ * The arrays are read in place by TraceView.
+ **/
+struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t frameSize;
+  uint32_t reserved;
+  uint64_t numTraces;
+  uint64_t directoryOffset;
+};
+
+struct TraceFileEntry {
+  uint64_t numCheckpoints;
+  uint64_t timesOffset;
+  uint64_t leadersOffset;
+  uint64_t valuesOffset;
+  Bit initvalue;
+  uint8_t reserved[7];
+};
+
+/**
+ * Writes Traces into a file that can be opened by TraceFile. Errors are
+ * reported by std::runtime_error.
+ **/
+class TraceFileWriter {
+public:
+  explicit TraceFileWriter(std::string const &path);
+  // closes the file if close() was not called, errors are ignored
+  ~TraceFileWriter();
+
+  // append trace, returns its index in the file
+  template <unsigned FrameSize, TraceValueEncoding Encoding>
+  std::size_t add(BasicTrace<FrameSize, Encoding> const &trace);
+
+  // write the directory, no Traces can be added afterwards
+  void close();
+
+private:
+  // disabled
+  TraceFileWriter(const TraceFileWriter &other);
+  TraceFileWriter &operator=(const TraceFileWriter &other);
+
+  static const std::size_t BufferSize = 4096;
+
+  void write(void const *data, std::size_t bytes);
+  void align();
+
+  std::string _path;
+  std::ofstream _out;
+  uint64_t _offset;
+  std::vector<TraceFileEntry> _entries;
+};
+
+/**
+ * A trace file mapped read-only into memory. Nothing is read on opening
+ * apart from the header and the directory, the pages of a Trace are loaded
+ * by the operating system when it is accessed and are shared by all
+ * processes mapping the same file.
+ *
+ * Errors on opening are reported by std::runtime_error.
+ **/
+class TraceFile {
+public:
+  explicit TraceFile(std::string const &path);
+  ~TraceFile();
+
+  // number of Traces in the file
+  std::size_t size() const;
+
+  // the Trace at index, valid as long as this TraceFile
+  TraceView view(std::size_t index) const;
+
+private:
+  // disabled
+  TraceFile(const TraceFile &other);
+  TraceFile &operator=(const TraceFile &other);
+
+  // checks the header and the directory, returns the directory
+  TraceFileEntry const *validate(std::string const &path) const;
+
+  char const *_data;
+  std::size_t _bytes;
+  TraceFileHeader const *_header;
+  TraceFileEntry const *_directory;
+};
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::size_t TraceFileWriter::add(BasicTrace<FrameSize, Encoding> const &trace) {
+  typedef typename BasicTrace<FrameSize, Encoding>::const_iterator Iterator;
+
+  TraceFileEntry entry = TraceFileEntry();
+  entry.initvalue = trace.getInitvalue();
+
+  // times and leaders in a first pass over the Trace
+  std::vector<PackedDeltaTime> leaders;
+  std::vector<PackedDeltaTime> times;
+  times.reserve(BufferSize);
+  align();
+  entry.timesOffset = _offset;
+  for (Iterator it = trace.begin(); it != trace.end(); ++it) {
+    PackedDeltaTime time = it.time().packed();
+    if (entry.numCheckpoints % TraceFrameSize == 0) {
+      leaders.push_back(time);
+    }
+    times.push_back(time);
+    ++entry.numCheckpoints;
+    if (times.size() == BufferSize) {
+      write(times.data(), times.size() * sizeof(PackedDeltaTime));
+      times.clear();
+    }
+  }
+  write(times.data(), times.size() * sizeof(PackedDeltaTime));
+
+  entry.leadersOffset = _offset;
+  write(leaders.data(), leaders.size() * sizeof(PackedDeltaTime));
+
+  // values in a second pass
+  std::vector<Bit> values;
+  values.reserve(BufferSize);
+  entry.valuesOffset = _offset;
+  for (Iterator it = trace.begin(); it != trace.end(); ++it) {
+    values.push_back(it.value());
+    if (values.size() == BufferSize) {
+      write(values.data(), values.size());
+      values.clear();
+    }
+  }
+  write(values.data(), values.size());
+
+  _entries.push_back(entry);
+  return _entries.size() - 1;
+}
+
+} // namespace svt
@@ -1,58 +1,171 @@
 #pragma once
 
 #include "Bit.h"
+#include "TraceFrameValues.h"
+#include "TraceFwd.h"
 
-#include <boost/array.hpp>
+#include <time/DeltaTime.h>
+
+#include <boost/static_assert.hpp>
+
+#include <iosfwd>
 
 namespace svt {
 
-const unsigned TraceFrameSize = 32;
 struct TraceFrameCurser;
 
-class TraceFrame {
+/**
+ * A sorted block of up to FrameSize checkpoints, the values are stored as
+ * selected by Encoding.
+ *
+ * The entries are stored directly behind the frame. The frames of a
+ * two-state Trace only store the values at even and odd positions
+ * (TraceFrameToggles), all other frames keep their values in
+ * TraceFrameValues behind the entries. The pool allocates storage_size()
+ * bytes for a frame.
+ *
+ * An embedded frame is stored in the Trace itself instead, see embed(). It
+ * only has room for EmbeddedSize entries, which are followed by its values.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+class BasicTraceFrame {
 public:
-  TraceFrame();
-  TraceFrame(const DeltaTimeFW &leader);
-  TraceFrame(const DeltaTimeFW &time, Bit const &value);
-  ~TraceFrame();
-
-  DeltaTimeFW leader() const;
-  DeltaTimeFW closer() const;
+  static const unsigned max_size = FrameSize;
+  // the number of used entries is kept in 16 bits
+  BOOST_STATIC_ASSERT(FrameSize <= 0xffff);
+
+  explicit BasicTraceFrame(bool twoState);
+  BasicTraceFrame(PackedDeltaTime leader, bool twoState);
+  BasicTraceFrame(PackedDeltaTime time, Bit const &value, bool twoState);
+  ~BasicTraceFrame();
+
+  static std::size_t storage_size(bool twoState);
+
+  // entries of an embedded frame, its storage takes EmbeddedBytes. The
+  // values are only accessed below capacity(), so room for EmbeddedSize of
+  // them is enough.
+  static const unsigned EmbeddedSize = FrameSize < 8 ? FrameSize : 8;
+  static const std::size_t EmbeddedBytes =
+      3 * sizeof(PackedDeltaTime) + EmbeddedSize * sizeof(PackedDeltaTime) +
+      sizeof(TraceFrameValues<EmbeddedSize, Encoding>);
+
+  /**
+   * create an empty embedded frame in storage, which is aligned like a
+   * PackedDeltaTime. It is not owned by a pool: sharing it fails and
+   * destroying it through the pool does nothing.
+   **/
+  static BasicTraceFrame *embed(void *storage, bool twoState);
+  bool embedded() const { return _embedded; }
+  // the number of entries that fit into the frame
+  unsigned capacity() const { return _embedded ? EmbeddedSize : FrameSize; }
+
+  bool two_state() const { return _twoState; }
+
+  /**
+   * A hash of the entries, the sum of a hash of every entry. So the hashes of
+   * the frames of a Trace add up to the same value however its entries are
+   * divided into frames. It is kept until the frame is written, including
+   * any call of the writable time_at().
+   **/
+  uint64_t hash() const;
+
+  // owners of the frame besides the first one, see BasicTraceFramePool::share
+  static const unsigned MaxShares = 0xffff;
+  unsigned shares() const { return _shares; }
+  void set_shares(unsigned shares) { _shares = shares; }
+
+  // copy all entries of other, the value storage of this frame is kept
+  void assign(BasicTraceFrame const &other);
+  // replace all entries by count sorted entries
+  void assign(PackedDeltaTime const *times, Bit const *values,
+              unsigned count);
+
+  PackedDeltaTime leader() const;
+  PackedDeltaTime closer() const;
 
   bool full() const;
 
-  bool set(const DeltaTimeFW &t, const Bit &value);
+  bool set(PackedDeltaTime t, const Bit &value);
 
-  TraceFrame *split(const DeltaTimeFW &t);
+  // move all entries from t on into a new frame created by pool
+  BasicTraceFrame *split(PackedDeltaTime t,
+                         BasicTraceFramePool<FrameSize, Encoding> &pool);
 
   // Access funtions for cursers
-  DeltaTimeFW &time_at(size_t pos);
-  DeltaTimeFW const &time_at(size_t pos) const;
-  Bit &bit_at(size_t pos);
-  Bit const &bit_at(size_t pos) const;
+  PackedDeltaTime &time_at(size_t pos);
+  PackedDeltaTime const &time_at(size_t pos) const;
+  Bit bit_at(size_t pos) const;
+  void set_bit(size_t pos, Bit const &value);
+  // write the values of [first, first + count) to out
+  void decode_bits(size_t first, size_t count, Bit *out) const;
 
   unsigned num_used() const;
   bool empty() const;
 
   // iterators
-  typedef const DeltaTimeFW *const_iterator;
+  typedef const PackedDeltaTime *const_iterator;
 
-  const DeltaTimeFW *begin() const;
-  const DeltaTimeFW *end() const;
+  const PackedDeltaTime *begin() const;
+  const PackedDeltaTime *end() const;
 
-  void reset(const DeltaTimeFW &leader = DeltaTimeFW(0, 0));
+  void reset(PackedDeltaTime leader = 0);
   void truncate(unsigned maxLength);
   void erase(size_t pos);
-  void insert(size_t pos, DeltaTimeFW const &t, Bit const &value);
-
-  // output
-  friend std::ostream &operator<<(std::ostream &o, TraceFrame const &);
+  // remove the entries [first, last)
+  void erase(size_t first, size_t last);
+  void insert(size_t pos, PackedDeltaTime t, Bit const &value);
+  // append after closer(), the frame must not be full
+  void push_back(PackedDeltaTime t, Bit const &value);
+  // append sorted entries after closer() until the frame is full, skipping
+  // entries equal to lastValue. Returns the number of consumed entries,
+  // lastValue is updated to the value of the last consumed entry.
+  size_t append_changes(DeltaTime const *times, Bit const *values,
+                        size_t count, Bit &lastValue);
+  // move the first count entries of other, which are after closer(), to the
+  // end of this frame
+  void take_front(BasicTraceFrame &other, unsigned count);
 
 private:
-  DeltaTimeFW _leader;
-  unsigned _used;
-  boost::array<DeltaTimeFW, TraceFrameSize> _times;
-  boost::array<Bit, TraceFrameSize> _values;
+  typedef TraceFrameValues<FrameSize, Encoding> Values;
+
+  PackedDeltaTime *times() {
+    return reinterpret_cast<PackedDeltaTime *>(this + 1);
+  }
+  PackedDeltaTime const *times() const {
+    return reinterpret_cast<PackedDeltaTime const *>(this + 1);
+  }
+
+  Values &values() {
+    return *reinterpret_cast<Values *>(times() + capacity());
+  }
+  Values const &values() const {
+    return const_cast<BasicTraceFrame *>(this)->values();
+  }
+
+  void move_values(unsigned first, unsigned last, unsigned dest);
+
+  size_t append_toggles(DeltaTime const *times, Bit const *values,
+                        size_t count, Bit &lastValue);
+
+  // _hash of a frame written since the last hash(), and of a frame whose
+  // hash is 0
+  static const uint64_t NoHash = 0;
+  static uint64_t hash_entry(PackedDeltaTime t, Bit const &value);
+
+  PackedDeltaTime _leader;
+  uint16_t _used;
+  bool _twoState;
+  bool _embedded;
+  TraceFrameToggles _toggles;
+  uint16_t _shares;
+  mutable uint64_t _hash;
 };
 
+typedef BasicTraceFrame<TraceFrameSize> TraceFrame;
+
+// output
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::ostream &operator<<(std::ostream &o,
+                         BasicTraceFrame<FrameSize, Encoding> const &frame);
+
 } // namespace svt
@@ -1,181 +1,445 @@
 #pragma once
 
+#include <trace/FrameSearch.h>
 #include <trace/TraceFrame.h>
+#include <trace/TraceFramePool.h>
+
+#include <algorithm>
+#include <new>
+#include <ostream>
 
 namespace svt {
 
-TraceFrame::TraceFrame() : _leader(DeltaTime(0, 0)), _used(0) {}
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+const unsigned BasicTraceFrame<FrameSize, Encoding>::max_size;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFrame<FrameSize, Encoding>::BasicTraceFrame(bool twoState)
+    : _leader(0), _used(0), _twoState(twoState), _embedded(false),
+      _shares(0), _hash(NoHash) {
+  if (!_twoState) {
+    new (&values()) Values;
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFrame<FrameSize, Encoding>::BasicTraceFrame(PackedDeltaTime leader,
+                                                      bool twoState)
+    : _leader(leader), _used(0), _twoState(twoState), _embedded(false),
+      _shares(0), _hash(NoHash) {
+  if (!_twoState) {
+    new (&values()) Values;
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFrame<FrameSize, Encoding>::BasicTraceFrame(PackedDeltaTime leader,
+                                                      Bit const &value,
+                                                      bool twoState)
+    : _leader(leader), _used(1), _twoState(twoState), _embedded(false),
+      _shares(0), _hash(NoHash) {
+  if (!_twoState) {
+    new (&values()) Values;
+  }
+  times()[0] = leader;
+  set_bit(0, value);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFrame<FrameSize, Encoding>::~BasicTraceFrame() {}
 
-TraceFrame::TraceFrame(const DeltaTimeFW &leader) : _leader(leader), _used(0) {}
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::size_t BasicTraceFrame<FrameSize, Encoding>::storage_size(bool twoState) {
+  return sizeof(BasicTraceFrame) + FrameSize * sizeof(PackedDeltaTime) +
+         (twoState ? 0 : sizeof(Values));
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+const unsigned BasicTraceFrame<FrameSize, Encoding>::EmbeddedSize;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+const std::size_t BasicTraceFrame<FrameSize, Encoding>::EmbeddedBytes;
 
-TraceFrame::TraceFrame(const DeltaTimeFW &leader, Bit const &value)
-    : _leader(leader), _used(1) {
-  _times[0] = leader;
-  _values[0] = value;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+const uint64_t BasicTraceFrame<FrameSize, Encoding>::NoHash;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFrame<FrameSize, Encoding> *
+BasicTraceFrame<FrameSize, Encoding>::embed(void *storage, bool twoState) {
+  // EmbeddedBytes assumes a header of three PackedDeltaTime
+  BOOST_STATIC_ASSERT(sizeof(BasicTraceFrame) == 3 * sizeof(PackedDeltaTime));
+  BasicTraceFrame *frame = new (storage) BasicTraceFrame(true);
+  frame->_embedded = true;
+  frame->_twoState = twoState;
+  return frame;
 }
 
-TraceFrame::~TraceFrame() {}
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::assign(
+    BasicTraceFrame const &other) {
+  _hash = NoHash;
+  assert(other._used <= capacity());
+  _leader = other._leader;
+  _used = other._used;
+  std::copy(other.times(), other.times() + _used, times());
+  for (unsigned pos = 0; pos < _used; ++pos) {
+    set_bit(pos, other.bit_at(pos));
+  }
+}
 
-void TraceFrame::reset(const DeltaTimeFW &leader) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::assign(PackedDeltaTime const *times,
+                                                  Bit const *values,
+                                                  unsigned count) {
+  _hash = NoHash;
+  assert(count > 0 && count <= capacity());
+  _leader = times[0];
+  _used = count;
+  std::copy(times, times + count, this->times());
+  for (unsigned pos = 0; pos < count; ++pos) {
+    set_bit(pos, values[pos]);
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::move_values(unsigned first,
+                                                       unsigned last,
+                                                       unsigned dest) {
+  if (_twoState) {
+    _toggles.move(first, last, dest);
+  } else {
+    values().move(first, last, dest);
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::reset(PackedDeltaTime leader) {
+  _hash = NoHash;
   _used = 0;
-  _times[0] = leader;
+  times()[0] = leader;
 }
 
-void TraceFrame::erase(size_t pos) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::erase(size_t pos) {
   assert(_used != 0);
-  assert(pos < TraceFrameSize);
+  assert(pos < capacity());
+
+  erase(pos, pos + 1);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::erase(size_t first, size_t last) {
+  _hash = NoHash;
+  assert(first <= last && last <= _used);
 
-  std::copy(_times.begin() + pos + 1, _times.begin() + num_used(),
-            _times.begin() + pos);
-  std::copy(_values.begin() + pos + 1, _values.begin() + num_used(),
-            _values.begin() + pos);
-  --_used;
+  std::copy(times() + last, times() + num_used(), times() + first);
+  move_values(last, num_used(), first);
+  _used -= last - first;
 }
 
-void TraceFrame::insert(size_t pos, DeltaTimeFW const &t, Bit const &value) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::insert(size_t pos,
+                                                  PackedDeltaTime t,
+                                                  Bit const &value) {
+  _hash = NoHash;
   assert(!full());
-  assert(pos < TraceFrameSize);
+  assert(pos < capacity());
 
-  std::copy_backward(_times.begin() + pos, _times.begin() + num_used(),
-                     _times.begin() + num_used() + 1);
-  std::copy_backward(_values.begin() + pos, _values.begin() + num_used(),
-                     _values.begin() + num_used() + 1);
+  std::copy_backward(times() + pos, times() + num_used(),
+                     times() + num_used() + 1);
+  move_values(pos, num_used(), pos + 1);
 
-  _times[pos] = t;
-  _values[pos] = value;
+  times()[pos] = t;
+  set_bit(pos, value);
 
   ++_used;
 }
 
-void TraceFrame::truncate(unsigned maxLength) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::push_back(PackedDeltaTime t,
+                                                     Bit const &value) {
+  _hash = NoHash;
+  assert(!full());
+  assert(_used == 0 || times()[_used - 1] < t);
+
+  times()[_used] = t;
+  set_bit(_used, value);
+  ++_used;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::take_front(BasicTraceFrame &other,
+                                                      unsigned count) {
+  _hash = NoHash;
+  assert(_used + count <= capacity() && count <= other._used);
+  assert(_used == 0 || count == 0 || times()[_used - 1] < other.times()[0]);
+
+  std::copy(other.times(), other.times() + count, times() + _used);
+  if (_twoState) {
+    // a single entry must not change the value of the other parity
+    for (unsigned pos = 0; pos < count && pos < 2; ++pos) {
+      _toggles.set(_used + pos, other._toggles.get(pos));
+    }
+  } else {
+    other.values().copy(0, count, values(), _used);
+  }
+  _used += count;
+  other.erase(0, count);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+size_t BasicTraceFrame<FrameSize, Encoding>::append_changes(
+    DeltaTime const *times, Bit const *values, size_t count, Bit &lastValue) {
+  _hash = NoHash;
+  if (_twoState) {
+    return append_toggles(times, values, count, lastValue);
+  }
+
+  Values &frameValues = this->values();
+  size_t i = 0;
+  Bit last = lastValue;
+  unsigned used = _used;
+  const unsigned capacity = this->capacity();
+
+  // write every entry and only advance on a change, this keeps the loop
+  // free of data dependent branches
+  for (; i < count && used < capacity; ++i) {
+    assert(used == 0 || this->times()[used - 1] < times[i].packed());
+    this->times()[used] = times[i].packed();
+    frameValues.set(used, values[i]);
+    used += (values[i] != last);
+    last = values[i];
+  }
+
+  _used = used;
+  lastValue = last;
+  return i;
+}
+
+// a value written to a two-state frame applies to all positions of the same
+// parity, so unlike append_changes only the changes are written
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+size_t BasicTraceFrame<FrameSize, Encoding>::append_toggles(
+    DeltaTime const *times, Bit const *values, size_t count, Bit &lastValue) {
+  _hash = NoHash;
+  size_t i = 0;
+  Bit last = lastValue;
+  unsigned used = _used;
+  const unsigned capacity = this->capacity();
+
+  for (; i < count && used < capacity; ++i) {
+    assert(used == 0 || this->times()[used - 1] < times[i].packed());
+    this->times()[used] = times[i].packed();
+    if (values[i] != last) {
+      _toggles.set(used, values[i]);
+      last = values[i];
+      ++used;
+    }
+  }
+
+  _used = used;
+  lastValue = last;
+  return i;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::truncate(unsigned maxLength) {
+  _hash = NoHash;
   if (maxLength < _used) {
     _used = maxLength;
   }
 }
 
-DeltaTimeFW TraceFrame::leader() const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+PackedDeltaTime BasicTraceFrame<FrameSize, Encoding>::leader() const {
   if (_used == 0) {
     return _leader;
   } else {
-    return _times[0];
+    return times()[0];
   }
 }
 
-DeltaTimeFW TraceFrame::closer() const {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+PackedDeltaTime BasicTraceFrame<FrameSize, Encoding>::closer() const {
   if (_used == 0) {
     return _leader;
   } else {
-    return _times[_used - 1];
+    return times()[_used - 1];
   }
 }
 
-bool TraceFrame::full() const { return _used == TraceFrameSize; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTraceFrame<FrameSize, Encoding>::full() const {
+  return _used == capacity();
+}
 
-TraceFrame *TraceFrame::split(const DeltaTimeFW &t) {
-  DeltaTimeFW *end = _times.begin() + _used;
-  DeltaTimeFW *lb = std::lower_bound(_times.begin(), end, t);
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFrame<FrameSize, Encoding> *BasicTraceFrame<FrameSize, Encoding>::
+    split(PackedDeltaTime t, BasicTraceFramePool<FrameSize, Encoding> &pool) {
+  PackedDeltaTime *end = times() + _used;
+  PackedDeltaTime *lb = times() + frame_lower_bound(times(), _used, t);
 
   if (lb == end) {
     return NULL;
   }
-  if (lb == _times.begin()) {
+  if (lb == times()) {
     return NULL;
   }
 
-  size_t pos = lb - _times.begin();
-  TraceFrame *new_frame = new TraceFrame(*lb);
+  size_t pos = lb - times();
+  BasicTraceFrame *new_frame = pool.create(_twoState);
+  new_frame->_leader = *lb;
 
-  std::copy(_times.begin() + pos, _times.end(), new_frame->_times.begin());
-  std::copy(_values.begin() + pos, _values.end(), new_frame->_values.begin());
+  std::copy(times() + pos, times() + _used, new_frame->times());
+  if (_twoState) {
+    _toggles.copy(pos, _used, new_frame->_toggles, 0);
+  } else {
+    values().copy(pos, _used, new_frame->values(), 0);
+  }
 
   new_frame->_used = _used - pos;
   _used = pos;
+  _hash = NoHash;
 
   return new_frame;
 }
 
-bool TraceFrame::set(const DeltaTimeFW &t, const Bit &value) {
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTraceFrame<FrameSize, Encoding>::set(PackedDeltaTime t,
+                                               const Bit &value) {
+  _hash = NoHash;
 
-  DeltaTimeFW *end = _times.begin() + _used;
-  DeltaTimeFW *lb = std::lower_bound(_times.begin(), end, t);
-  size_t pos = lb - _times.begin();
+  PackedDeltaTime *end = times() + _used;
+  PackedDeltaTime *lb = times() + frame_lower_bound(times(), _used, t);
+  size_t pos = lb - times();
 
   if (lb == end) {
     if (full()) {
       return false;
     }
-    _times[_used] = t;
-    _values[_used] = value;
+    times()[_used] = t;
+    set_bit(_used, value);
     ++_used;
   } else if (*lb == t) {
-    _values[pos] = value;
+    set_bit(pos, value);
   } else {
     if (full()) {
       return false;
     }
 
-    for (unsigned i = _used; i > pos; --i) {
-      _times[i] = _times[i - 1];
-      _values[i] = _values[i - 1];
-    }
-    _times[pos] = t;
-    _values[pos] = value;
+    std::copy_backward(times() + pos, end, end + 1);
+    move_values(pos, _used, pos + 1);
+    times()[pos] = t;
+    set_bit(pos, value);
     ++_used;
   }
 
   return true;
 }
 
-struct CompareTraceFrames {
-  bool operator()(TraceFrame const &a, TraceFrame const &b) const {
-    return a.leader() < b.leader();
-  }
-
-  bool operator()(TraceFrame const *a, TraceFrame const *b) const {
-    if (a == b) {
-      return false;
-    }
-    if (a == NULL) {
-      return false;
-    }
-    if (b == NULL) {
-      return true;
-    }
-    return (*this)(*a, *b);
-  }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+const PackedDeltaTime *BasicTraceFrame<FrameSize, Encoding>::begin() const {
+  return times();
+}
 
-  bool operator()(TraceFrame const &a, DeltaTime const &b) const {
-    return a.leader() < b;
-  }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+const PackedDeltaTime *BasicTraceFrame<FrameSize, Encoding>::end() const {
+  return times() + _used;
+}
 
-  bool operator()(TraceFrame const *a, DeltaTime const &b) const {
-    return a->leader() < b;
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+std::ostream &operator<<(std::ostream &o,
+                         BasicTraceFrame<FrameSize, Encoding> const &tf) {
+  o << "[ ";
+  for (unsigned i = 0; i < tf.num_used(); ++i) {
+    o << tf.bit_at(i) << '@' << DeltaTime::fromPacked(tf.time_at(i)) << ' ';
   }
-};
+  o << ']';
+  return o;
+}
 
-const DeltaTimeFW *TraceFrame::begin() const { return _times.begin(); }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+PackedDeltaTime &BasicTraceFrame<FrameSize, Encoding>::time_at(size_t pos) {
+  _hash = NoHash;
+  return times()[pos];
+}
 
-const DeltaTimeFW *TraceFrame::end() const { return _times.begin() + _used; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+PackedDeltaTime const &
+BasicTraceFrame<FrameSize, Encoding>::time_at(size_t pos) const {
+  return times()[pos];
+}
 
-std::ostream &operator<<(std::ostream &o, TraceFrame const &tf) {
-  o << "[ ";
-  for (unsigned i = 0; i < tf._used; ++i) {
-    o << tf._values[i] << '@' << tf._times[i] << ' ';
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+Bit BasicTraceFrame<FrameSize, Encoding>::bit_at(size_t pos) const {
+  if (_twoState) {
+    return _toggles.get(pos);
   }
-  o << ']';
-  return o;
+  return values().get(pos);
 }
 
-DeltaTimeFW &TraceFrame::time_at(size_t pos) { return _times[pos]; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+uint64_t BasicTraceFrame<FrameSize, Encoding>::hash_entry(PackedDeltaTime t,
+                                                          Bit const &value) {
+  // the finalizer of splitmix64, applied to the time and then the value
+  uint64_t h = t;
+  for (int round = 0; round < 2; ++round) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    h += value;
+  }
+  return h;
+}
 
-DeltaTimeFW const &TraceFrame::time_at(size_t pos) const { return _times[pos]; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+uint64_t BasicTraceFrame<FrameSize, Encoding>::hash() const {
+  // NoHash also marks a hash that is not computed yet. A frame whose hash is
+  // 0, like an empty one, is hashed again by every call. The hash is not
+  // remapped, it must stay the sum of the entries for Trace::fingerprint.
+  if (_hash == NoHash) {
+    uint64_t sum = 0;
+    for (unsigned pos = 0; pos < _used; ++pos) {
+      sum += hash_entry(times()[pos], bit_at(pos));
+    }
+    _hash = sum;
+  }
+  return _hash;
+}
 
-Bit &TraceFrame::bit_at(size_t pos) { return _values[pos]; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::set_bit(size_t pos,
+                                                   Bit const &value) {
+  _hash = NoHash;
+  if (_twoState) {
+    _toggles.set(pos, value);
+  } else {
+    values().set(pos, value);
+  }
+}
 
-Bit const &TraceFrame::bit_at(size_t pos) const { return _values[pos]; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFrame<FrameSize, Encoding>::decode_bits(size_t first,
+                                                       size_t count,
+                                                       Bit *out) const {
+  assert(first + count <= _used);
+  if (_twoState) {
+    _toggles.decode(first, count, out);
+  } else {
+    values().decode(first, count, out);
+  }
+}
 
-unsigned TraceFrame::num_used() const { return _used; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+unsigned BasicTraceFrame<FrameSize, Encoding>::num_used() const {
+  return _used;
+}
 
-bool TraceFrame::empty() const { return _used == 0; }
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTraceFrame<FrameSize, Encoding>::empty() const {
+  return _used == 0;
+}
 
 } // namespace svt
@@ -0,0 +1,305 @@
+#include "TraceFramePool.h"
+
+#include <trace/CompressedTraceFrame.h>
+#include <trace/TraceFrameImpl.h>
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace svt {
+
+namespace {
+// the first slab is small to keep short traces cheap, later slabs double
+// in size until MaxSlabFrames
+const std::size_t MinSlabFrames = 4;
+const std::size_t MaxSlabFrames = 1024;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFramePool<FrameSize, Encoding>::Slabs::Slabs(std::size_t frameBytes)
+    : frameBytes(frameBytes), capacity(0), nextSlabFrames(MinSlabFrames),
+      slabPos(NULL), slabEnd(NULL), free(NULL), inUse(0), recycled(0) {}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFramePool<FrameSize, Encoding>::BasicTraceFramePool()
+    : _general(Frame::storage_size(false)),
+      _twoState(Frame::storage_size(true)), _numberOfReferences(0) {}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+BasicTraceFramePool<FrameSize, Encoding>::~BasicTraceFramePool() {
+  assert(statistics().inUse == 0 &&
+         "all frames must be destroyed before the pool");
+  free_slabs(_general);
+  free_slabs(_twoState);
+  for (unsigned i = 0; i < _compressed.size(); ++i) {
+    if (_compressed[i] != NULL) {
+      free_slabs(*_compressed[i]);
+      delete _compressed[i];
+    }
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::free_slabs(Slabs &slabs) {
+  for (unsigned i = 0; i < slabs.slabs.size(); ++i) {
+    ::operator delete(slabs.slabs[i].begin);
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTraceFramePool<FrameSize, Encoding>::Slabs &
+BasicTraceFramePool<FrameSize, Encoding>::compressed_slabs(std::size_t bytes) {
+  std::size_t index = (bytes - 1) / CompressedGranularity;
+  if (index >= _compressed.size()) {
+    _compressed.resize(index + 1, NULL);
+  }
+  if (_compressed[index] == NULL) {
+    _compressed[index] = new Slabs((index + 1) * CompressedGranularity);
+  }
+  return *_compressed[index];
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void *BasicTraceFramePool<FrameSize, Encoding>::allocate(Slabs &slabs) {
+  ++slabs.inUse;
+
+  if (slabs.free != NULL) {
+    FreeFrame *frame = slabs.free;
+    slabs.free = frame->next;
+    --slabs.recycled;
+    return frame;
+  }
+
+  if (slabs.slabPos == slabs.slabEnd) {
+    std::size_t bytes = slabs.nextSlabFrames * slabs.frameBytes;
+    slabs.slabPos = static_cast<char *>(::operator new(bytes));
+    slabs.slabEnd = slabs.slabPos + bytes;
+    Slab slab = {slabs.slabPos, slabs.slabEnd};
+    slabs.slabs.push_back(slab);
+    slabs.capacity += slabs.nextSlabFrames;
+    slabs.nextSlabFrames = std::min(2 * slabs.nextSlabFrames, MaxSlabFrames);
+  }
+
+  void *frame = slabs.slabPos;
+  slabs.slabPos += slabs.frameBytes;
+  return frame;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTraceFramePool<FrameSize, Encoding>::Frame *
+BasicTraceFramePool<FrameSize, Encoding>::create(bool twoState) {
+  return new (allocate(slabs_for(twoState))) Frame(twoState);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTraceFramePool<FrameSize, Encoding>::Frame *
+BasicTraceFramePool<FrameSize, Encoding>::create(PackedDeltaTime leader,
+                                                 Bit const &value,
+                                                 bool twoState) {
+  return new (allocate(slabs_for(twoState))) Frame(leader, value, twoState);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::destroy(Frame *frame) {
+  if (frame->embedded()) {
+    // the storage belongs to a Trace
+    return;
+  }
+  if (frame->shares() > 0) {
+    frame->set_shares(frame->shares() - 1);
+    return;
+  }
+  Slabs &slabs = slabs_for(frame->two_state());
+  frame->~Frame();
+  release(slabs, frame);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+CompressedTraceFrame *
+BasicTraceFramePool<FrameSize, Encoding>::create_compressed(
+    Frame const &frame) {
+  std::size_t bytes = CompressedTraceFrame::size_for(frame);
+  if (bytes == 0 || bytes >= Frame::storage_size(frame.two_state())) {
+    return NULL;
+  }
+  return new (allocate(compressed_slabs(bytes))) CompressedTraceFrame(frame);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::destroy(
+    CompressedTraceFrame *frame) {
+  if (frame->shares() > 0) {
+    frame->set_shares(frame->shares() - 1);
+    return;
+  }
+  release(compressed_slabs(frame->size()), frame);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTraceFramePool<FrameSize, Encoding>::share(Frame *frame) {
+  // an embedded frame lives no longer than its Trace
+  if (frame->embedded() || frame->shares() == Frame::MaxShares) {
+    return false;
+  }
+  frame->set_shares(frame->shares() + 1);
+  return true;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTraceFramePool<FrameSize, Encoding>::share(
+    CompressedTraceFrame *frame) {
+  if (frame->shares() == CompressedTraceFrame::MaxShares) {
+    return false;
+  }
+  frame->set_shares(frame->shares() + 1);
+  return true;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::release(Slabs &slabs,
+                                                       void *frame) {
+  assert(slabs.inUse > 0);
+
+  FreeFrame *freeFrame = static_cast<FreeFrame *>(frame);
+  freeFrame->next = slabs.free;
+  slabs.free = freeFrame;
+
+  --slabs.inUse;
+  ++slabs.recycled;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::trim() {
+  trim(_general);
+  trim(_twoState);
+  for (unsigned i = 0; i < _compressed.size(); ++i) {
+    if (_compressed[i] != NULL) {
+      trim(*_compressed[i]);
+    }
+  }
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::trim(Slabs &slabs) {
+  if (slabs.free == NULL) {
+    return;
+  }
+
+  // count the released frames of every slab
+  std::vector<std::pair<char *, std::size_t> > byAddress;
+  for (std::size_t i = 0; i < slabs.slabs.size(); ++i) {
+    byAddress.push_back(std::make_pair(slabs.slabs[i].begin, i));
+  }
+  std::sort(byAddress.begin(), byAddress.end());
+
+  std::vector<std::size_t> released(slabs.slabs.size(), 0);
+  for (FreeFrame *frame = slabs.free; frame != NULL; frame = frame->next) {
+    std::pair<char *, std::size_t> key(reinterpret_cast<char *>(frame),
+                                       slabs.slabs.size());
+    ++released[(std::upper_bound(byAddress.begin(), byAddress.end(), key) -
+                1)->second];
+  }
+
+  // a slab is unused if all frames handed out from it were released, only
+  // the last slab may not have handed out all of its frames yet
+  std::vector<bool> unused(slabs.slabs.size(), false);
+  bool anyUnused = false;
+  for (std::size_t i = 0; i < slabs.slabs.size(); ++i) {
+    Slab const &slab = slabs.slabs[i];
+    bool current = i + 1 == slabs.slabs.size() && slabs.slabPos != NULL;
+    char *handedOut = current ? slabs.slabPos : slab.end;
+    unused[i] = released[i] ==
+                static_cast<std::size_t>(handedOut - slab.begin) /
+                    slabs.frameBytes;
+    anyUnused = anyUnused || unused[i];
+  }
+  if (!anyUnused) {
+    return;
+  }
+
+  // unlink the frames of the unused slabs before freeing them
+  FreeFrame **link = &slabs.free;
+  while (*link != NULL) {
+    std::pair<char *, std::size_t> key(reinterpret_cast<char *>(*link),
+                                       slabs.slabs.size());
+    if (unused[(std::upper_bound(byAddress.begin(), byAddress.end(), key) -
+                1)->second]) {
+      *link = (*link)->next;
+      --slabs.recycled;
+    } else {
+      link = &(*link)->next;
+    }
+  }
+
+  std::vector<Slab> kept;
+  for (std::size_t i = 0; i < slabs.slabs.size(); ++i) {
+    Slab const &slab = slabs.slabs[i];
+    if (!unused[i]) {
+      kept.push_back(slab);
+      continue;
+    }
+    if (slabs.slabPos != NULL && slabs.slabPos >= slab.begin &&
+        slabs.slabPos <= slab.end) {
+      slabs.slabPos = NULL;
+      slabs.slabEnd = NULL;
+    }
+    slabs.capacity -= (slab.end - slab.begin) / slabs.frameBytes;
+    ::operator delete(slab.begin);
+  }
+  slabs.slabs.swap(kept);
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+typename BasicTraceFramePool<FrameSize, Encoding>::Statistics
+BasicTraceFramePool<FrameSize, Encoding>::statistics() const {
+  Statistics stats = {0, 0, 0, 0, 0};
+  add_statistics(_general, stats);
+  add_statistics(_twoState, stats);
+  for (unsigned i = 0; i < _compressed.size(); ++i) {
+    if (_compressed[i] != NULL) {
+      add_statistics(*_compressed[i], stats);
+    }
+  }
+  return stats;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::add_statistics(
+    Slabs const &slabs, Statistics &stats) {
+  stats.slabs += slabs.slabs.size();
+  stats.capacity += slabs.capacity;
+  stats.inUse += slabs.inUse;
+  stats.recycled += slabs.recycled;
+  stats.bytes += slabs.capacity * slabs.frameBytes;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+void BasicTraceFramePool<FrameSize, Encoding>::add_ref() {
+  ++_numberOfReferences;
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+bool BasicTraceFramePool<FrameSize, Encoding>::release() {
+  if (_numberOfReferences > 0) {
+    --_numberOfReferences;
+  }
+  return _numberOfReferences == 0;
+}
+
+template class BasicTraceFramePool<16, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<16, TRACE_VALUES_NIBBLE>;
+template class BasicTraceFramePool<32, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<32, TRACE_VALUES_NIBBLE>;
+template class BasicTraceFramePool<64, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<64, TRACE_VALUES_NIBBLE>;
+template class BasicTraceFramePool<128, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<128, TRACE_VALUES_NIBBLE>;
+template class BasicTraceFramePool<256, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<256, TRACE_VALUES_NIBBLE>;
+template class BasicTraceFramePool<512, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<512, TRACE_VALUES_NIBBLE>;
+template class BasicTraceFramePool<1024, TRACE_VALUES_BYTE>;
+template class BasicTraceFramePool<1024, TRACE_VALUES_NIBBLE>;
+
+} // namespace svt
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+#include <trace/TraceFwd.h>
+
+#include <boost/intrusive_ptr.hpp>
+
+#include <vector>
+
+namespace svt {
+
+/**
+ * Allocates TraceFrames from contiguous slabs and recycles released frames
+ * instead of returning them to the heap.
+ *
+ * A pool can be shared by several Traces, e.g. a Trace and its clones or
+ * all signals of one design. It is not thread safe, all Traces sharing a
+ * pool must be modified from the same thread.
+ *
+ * Frames of two-state Traces are smaller than the others, both sizes are
+ * kept in separate slabs. Compressed frames have a size of their own and
+ * are kept in slabs for every multiple of CompressedGranularity bytes.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+class BasicTraceFramePool {
+public:
+  typedef BasicTraceFrame<FrameSize, Encoding> Frame;
+
+  struct Statistics {
+    std::size_t slabs;    // number of allocated slabs
+    std::size_t capacity; // frames that fit into all slabs
+    std::size_t inUse;    // frames currently owned by Traces, shared
+                          // frames count once
+    std::size_t recycled; // released frames waiting to be reused
+    std::size_t bytes;    // memory held by the slabs
+  };
+
+  BasicTraceFramePool();
+  ~BasicTraceFramePool();
+
+  Frame *create(bool twoState);
+  Frame *create(PackedDeltaTime leader, Bit const &value, bool twoState);
+  // release one owner of frame, the last one destroys it. Embedded frames
+  // are not owned by the pool and left alone.
+  void destroy(Frame *frame);
+
+  /**
+   * compress the entries of frame, which is not changed. Returns NULL if
+   * the compressed frame would not be smaller.
+   **/
+  CompressedTraceFrame *create_compressed(Frame const &frame);
+  void destroy(CompressedTraceFrame *frame);
+
+  /**
+   * add an owner to frame, e.g. a clone of the Trace holding it. Returns
+   * false if the frame has MaxShares owners already or is embedded, it must
+   * be copied then. A shared frame must not be changed by any of its owners.
+   **/
+  bool share(Frame *frame);
+  bool share(CompressedTraceFrame *frame);
+
+  // return the slabs without any frame in use to the heap
+  void trim();
+
+  Statistics statistics() const;
+
+  void add_ref();
+  bool release();
+
+private:
+  // disabled
+  BasicTraceFramePool(const BasicTraceFramePool &other);
+  BasicTraceFramePool &operator=(const BasicTraceFramePool &other);
+
+  static const std::size_t CompressedGranularity = 16;
+
+  struct FreeFrame {
+    FreeFrame *next;
+  };
+
+  struct Slab {
+    char *begin;
+    char *end;
+  };
+
+  // the slabs for frames of one size
+  struct Slabs {
+    Slabs(std::size_t frameBytes);
+
+    std::size_t frameBytes;
+    std::vector<Slab> slabs;
+    std::size_t capacity;
+    std::size_t nextSlabFrames;
+    char *slabPos;
+    char *slabEnd;
+    FreeFrame *free;
+    std::size_t inUse;
+    std::size_t recycled;
+  };
+
+  Slabs &slabs_for(bool twoState) { return twoState ? _twoState : _general; }
+  Slabs &compressed_slabs(std::size_t bytes);
+  void *allocate(Slabs &slabs);
+  void release(Slabs &slabs, void *frame);
+  static void trim(Slabs &slabs);
+  static void free_slabs(Slabs &slabs);
+  static void add_statistics(Slabs const &slabs, Statistics &stats);
+
+  Slabs _general;
+  Slabs _twoState;
+  // created on demand, indexed by the size in CompressedGranularity units
+  std::vector<Slabs *> _compressed;
+  unsigned _numberOfReferences;
+};
+
+typedef BasicTraceFramePool<TraceFrameSize> TraceFramePool;
+typedef boost::intrusive_ptr<TraceFramePool> TraceFramePoolPtr;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+inline void
+intrusive_ptr_add_ref(BasicTraceFramePool<FrameSize, Encoding> *p) {
+  p->add_ref();
+}
+
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+inline void
+intrusive_ptr_release(BasicTraceFramePool<FrameSize, Encoding> *p) {
+  if (p->release()) {
+    delete p;
+  }
+}
+
+} // namespace svt
@@ -0,0 +1,584 @@
+#pragma once
+
+#include <trace/CompressedTraceFrame.h>
+#include <trace/TraceFrame.h>
+
+#include <algorithm>
+#include <new>
+
+namespace svt {
+
+/**
+ * The ordered sequence of frames of a Trace.
+ *
+ * Next to the frame pointers it keeps the leader of every frame, so
+ * searching for a time only touches the leaders and the single frame that
+ * is finally selected. Structural changes must go through this class,
+ * whenever the first entry of a frame changes update_leader has to be
+ * called for it.
+ *
+ * The frames are addressed by their index, but they are not kept in one
+ * array: a frame inserted into the middle of a long Trace would move all
+ * later frames. Instead the sequence is split into blocks of BlockSize
+ * frames, all blocks but the last one are full. Each block is a ring
+ * buffer, so an insert or erase only moves the frames of its own block and
+ * passes one frame between each of the following blocks by rotating them.
+ * That costs O(BlockSize + size() / BlockSize) instead of O(size()), while
+ * the block and slot of an index are still found without a search. The
+ * table of the blocks and the first block start out inside the sequence,
+ * a sequence of one frame does not allocate.
+ *
+ * A frame may be replaced by its CompressedTraceFrame. Reading such a frame
+ * through the const accessors decompresses it into a cache of the sequence,
+ * the returned frame is valid until the next access to another compressed
+ * frame or the next change of the sequence. So even reading is not thread
+ * safe once frames are compressed. The non-const accessors only accept
+ * frames that are not compressed.
+ *
+ * Frames and compressed frames may be shared with the sequences of clones,
+ * see BasicTraceFramePool::share. The owner has to replace a shared frame
+ * by a copy before changing it.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+class BasicTraceFrameSeq {
+public:
+  typedef BasicTraceFrame<FrameSize, Encoding> Frame;
+  typedef BasicTraceFramePool<FrameSize, Encoding> Pool;
+
+  // frames per block, a block of 512 frames takes 8 KiB
+  static const unsigned BlockBits = 9;
+  static const std::size_t BlockSize = std::size_t(1) << BlockBits;
+
+  BasicTraceFrameSeq()
+      : _blocks(&_firstBlock), _numBlocks(0), _maxBlocks(1), _size(0),
+        _numCompressed(0), _nextCache(0) {
+    for (unsigned i = 0; i < NumCached; ++i) {
+      _cache[i] = NULL;
+      _cached[i] = NotCached;
+    }
+  }
+
+  ~BasicTraceFrameSeq() {
+    while (_numBlocks > 0) {
+      pop_block();
+    }
+    if (_blocks != &_firstBlock) {
+      delete[] _blocks;
+    }
+    for (unsigned i = 0; i < NumCached; ++i) {
+      if (_cache[i] != NULL) {
+        _cache[i]->~Frame();
+        ::operator delete(_cache[i]);
+      }
+    }
+  }
+
+  std::size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  Frame const *operator[](std::size_t pos) const {
+    Frame *frame = frame_at(pos);
+    return is_compressed(frame) ? decompressed(pos) : frame;
+  }
+  Frame *operator[](std::size_t pos) {
+    assert(!is_compressed(frame_at(pos)));
+    return frame_at(pos);
+  }
+  Frame const *front() const { return (*this)[0]; }
+  Frame *front() { return (*this)[0]; }
+  Frame const *back() const { return (*this)[size() - 1]; }
+  Frame *back() { return (*this)[size() - 1]; }
+
+  PackedDeltaTime leader(std::size_t pos) const { return leader_at(pos); }
+
+  // number of entries of the frame at pos without decompressing it
+  unsigned num_used(std::size_t pos) const {
+    Frame *frame = frame_at(pos);
+    return is_compressed(frame) ? compressed_of(frame)->num_used()
+                                : frame->num_used();
+  }
+
+  std::size_t num_compressed() const { return _numCompressed; }
+  bool compressed(std::size_t pos) const {
+    return is_compressed(frame_at(pos));
+  }
+  CompressedTraceFrame *compressed_frame(std::size_t pos) const {
+    assert(compressed(pos));
+    return compressed_of(frame_at(pos));
+  }
+
+  // true if the frame at pos is the one at otherPos of other, with the same
+  // leader, so both hold the same entries
+  bool same_frame(std::size_t pos, BasicTraceFrameSeq const &other,
+                  std::size_t otherPos) const {
+    return frame_at(pos) == other.frame_at(otherPos) &&
+           leader_at(pos) == other.leader_at(otherPos);
+  }
+
+  // true if the frame at pos has other owners as well
+  bool shared(std::size_t pos) const {
+    Frame *frame = frame_at(pos);
+    return (is_compressed(frame) ? compressed_of(frame)->shares()
+                                 : frame->shares()) > 0;
+  }
+
+  // add an owner to the frame at pos, false if it has too many already
+  bool share(std::size_t pos, Pool &pool) const {
+    Frame *frame = frame_at(pos);
+    return is_compressed(frame) ? pool.share(compressed_of(frame))
+                                : pool.share(frame);
+  }
+
+  void update_leader(std::size_t pos) {
+    leader_at(pos) = frame_at(pos)->leader();
+  }
+
+  /**
+   * move the compressed frame at pos to start at leader. Its times are
+   * stored relative to the leader, so all of them move by the same amount.
+   **/
+  void move_compressed(std::size_t pos, PackedDeltaTime leader) {
+    assert(compressed(pos));
+    invalidate_cache();
+    leader_at(pos) = leader;
+  }
+
+  /**
+   * put the frame at from in place of the frame at to, which is not
+   * destroyed. The entry at from is unchanged until it is overwritten or
+   * erased as well.
+   **/
+  void move_frame(std::size_t from, std::size_t to) {
+    invalidate_cache();
+    _numCompressed -= is_compressed(frame_at(to));
+    _numCompressed += is_compressed(frame_at(from));
+    move(from, to);
+  }
+
+  void push_back(Frame *frame) {
+    grow();
+    set(_size - 1, frame, frame->leader());
+  }
+
+  /**
+   * append the frame at pos of other, which may be compressed, without
+   * copying it. Returns false if the frame has too many owners already.
+   **/
+  bool push_back_shared(BasicTraceFrameSeq const &other, std::size_t pos,
+                        Pool &pool) {
+    if (!other.share(pos, pool)) {
+      return false;
+    }
+    grow();
+    set(_size - 1, other.frame_at(pos), other.leader_at(pos));
+    _numCompressed += is_compressed(other.frame_at(pos));
+    return true;
+  }
+
+  void pop_back() { erase(size() - 1); }
+
+  void insert(std::size_t pos, Frame *frame) {
+    invalidate_cache();
+    open(pos, 1);
+    set(pos, frame, frame->leader());
+  }
+
+  // put frame in place of the frame at pos, which is not destroyed
+  void replace(std::size_t pos, Frame *frame) {
+    invalidate_cache();
+    _numCompressed -= is_compressed(frame_at(pos));
+    set(pos, frame, frame->leader());
+  }
+
+  /**
+   * put the compressed form of the frame at pos in its place, the frame is
+   * not destroyed.
+   **/
+  void compress(std::size_t pos, CompressedTraceFrame *frame) {
+    assert(!compressed(pos));
+    invalidate_cache();
+    frame_at(pos) = reinterpret_cast<Frame *>(
+        reinterpret_cast<uintptr_t>(frame) | CompressedTag);
+    ++_numCompressed;
+  }
+
+  void erase(std::size_t pos) { erase(pos, pos + 1); }
+
+  // remove the frames [first, last), the frames are not destroyed
+  void erase(std::size_t first, std::size_t last) {
+    invalidate_cache();
+    for (std::size_t i = first; i < last && _numCompressed > 0; ++i) {
+      _numCompressed -= is_compressed(frame_at(i));
+    }
+    close(first, last - first);
+  }
+
+  /**
+   * replace the frames [first, last) by the frames [otherFirst, otherLast)
+   * of other. No frame is copied or destroyed, the caller accounts for the
+   * owners of all of them.
+   **/
+  void splice(std::size_t first, std::size_t last,
+              BasicTraceFrameSeq const &other, std::size_t otherFirst,
+              std::size_t otherLast) {
+    invalidate_cache();
+    for (std::size_t i = first; i < last; ++i) {
+      _numCompressed -= is_compressed(frame_at(i));
+    }
+    for (std::size_t i = otherFirst; i < otherLast; ++i) {
+      _numCompressed += is_compressed(other.frame_at(i));
+    }
+    // only the difference in length moves the later frames
+    const std::size_t count = last - first;
+    const std::size_t otherCount = otherLast - otherFirst;
+    if (otherCount > count) {
+      open(last, otherCount - count);
+    } else {
+      close(first + otherCount, count - otherCount);
+    }
+    for (std::size_t i = 0; i < otherCount; ++i) {
+      set(first + i, other.frame_at(otherFirst + i),
+          other.leader_at(otherFirst + i));
+    }
+  }
+
+  void resize(std::size_t size) {
+    if (size < _size) {
+      erase(size, _size);
+    }
+    while (_size < size) {
+      grow();
+      set(_size - 1, NULL, 0);
+    }
+  }
+
+  // heap memory of the sequence, without the frames
+  std::size_t bytes() const {
+    std::size_t bytes =
+        _blocks != &_firstBlock ? _maxBlocks * sizeof(Block *) : 0;
+    for (std::size_t i = 0; i < _numBlocks; ++i) {
+      if (_blocks[i] != embedded_block()) {
+        bytes += sizeof(Block) + _blocks[i]->capacity() * EntryBytes;
+      }
+    }
+    for (unsigned i = 0; i < NumCached; ++i) {
+      if (_cache[i] != NULL) {
+        bytes += Frame::storage_size(false);
+      }
+    }
+    return bytes;
+  }
+
+  /**
+   * index of the first frame with a leader after t, size() if there is
+   * none.
+   **/
+  std::size_t upper_bound(PackedDeltaTime t) const {
+    // the last block starting at or before t
+    std::size_t first = 0;
+    std::size_t count = _numBlocks;
+    while (count > 0) {
+      const std::size_t half = count / 2;
+      Block *block = _blocks[first + half];
+      if (block->leaders()[block->head] <= t) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    if (first == 0) {
+      return 0;
+    }
+
+    // the first leader after t in that block
+    Block *block = _blocks[first - 1];
+    PackedDeltaTime const *leaders = block->leaders();
+    const std::size_t begin = (first - 1) << BlockBits;
+    std::size_t pos = 0;
+    count = _size - begin < BlockSize ? _size - begin : BlockSize;
+    while (count > 0) {
+      const std::size_t half = count / 2;
+      if (leaders[block->slot(pos + half)] <= t) {
+        pos += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    return begin + pos;
+  }
+
+private:
+  // disabled
+  BasicTraceFrameSeq(const BasicTraceFrameSeq &other);
+  BasicTraceFrameSeq &operator=(const BasicTraceFrameSeq &other);
+
+  /**
+   * A ring buffer of a power of two frames, the frame pointers and the
+   * leaders are stored behind it. Only the first block grows up to
+   * BlockSize, the following ones are created full size.
+   **/
+  struct Block {
+    std::size_t head;
+    std::size_t mask;
+
+    std::size_t capacity() const { return mask + 1; }
+    Frame **frames() { return reinterpret_cast<Frame **>(this + 1); }
+    PackedDeltaTime *leaders() {
+      return reinterpret_cast<PackedDeltaTime *>(frames() + capacity());
+    }
+
+    std::size_t slot(std::size_t offset) const {
+      return (head + offset) & mask;
+    }
+  };
+
+  static const std::size_t EntryBytes =
+      sizeof(Frame *) + sizeof(PackedDeltaTime);
+
+  // the storage of the first block of capacity 1, a sequence of a single
+  // frame does not allocate it
+  static const std::size_t EmbeddedBlockWords =
+      (sizeof(Block) + EntryBytes) / sizeof(PackedDeltaTime);
+
+  // frames and compressed frames are at least 2 byte aligned, the lowest
+  // bit of a slot tells them apart
+  static const uintptr_t CompressedTag = 1;
+
+  // two frames, a search often steps back to the previous frame
+  static const unsigned NumCached = 2;
+  static const std::size_t NotCached = ~std::size_t(0);
+
+  static const std::size_t OffsetMask = BlockSize - 1;
+
+  static bool is_compressed(Frame *frame) {
+    return (reinterpret_cast<uintptr_t>(frame) & CompressedTag) != 0;
+  }
+  static CompressedTraceFrame *compressed_of(Frame *frame) {
+    return reinterpret_cast<CompressedTraceFrame *>(
+        reinterpret_cast<uintptr_t>(frame) & ~CompressedTag);
+  }
+
+  Frame *&frame_at(std::size_t pos) const {
+    Block *block = _blocks[pos >> BlockBits];
+    return block->frames()[block->slot(pos & OffsetMask)];
+  }
+  PackedDeltaTime &leader_at(std::size_t pos) const {
+    Block *block = _blocks[pos >> BlockBits];
+    return block->leaders()[block->slot(pos & OffsetMask)];
+  }
+  void set(std::size_t pos, Frame *frame, PackedDeltaTime leader) {
+    Block *block = _blocks[pos >> BlockBits];
+    const std::size_t slot = block->slot(pos & OffsetMask);
+    block->frames()[slot] = frame;
+    block->leaders()[slot] = leader;
+  }
+  void move(std::size_t from, std::size_t to) {
+    set(to, frame_at(from), leader_at(from));
+  }
+
+  Block *embedded_block() const {
+    return reinterpret_cast<Block *>(
+        const_cast<PackedDeltaTime *>(_embeddedBlock));
+  }
+
+  // only the first block is created with capacity 1
+  Block *create_block(std::size_t capacity) {
+    Block *block = capacity == 1 ? embedded_block()
+                                 : static_cast<Block *>(::operator new(
+                                       sizeof(Block) + capacity * EntryBytes));
+    block->head = 0;
+    block->mask = capacity - 1;
+    return block;
+  }
+  void free_block(Block *block) {
+    if (block != embedded_block()) {
+      ::operator delete(block);
+    }
+  }
+
+  void push_block(Block *block) {
+    if (_numBlocks == _maxBlocks) {
+      Block **blocks = new Block *[2 * _maxBlocks];
+      std::copy(_blocks, _blocks + _numBlocks, blocks);
+      if (_blocks != &_firstBlock) {
+        delete[] _blocks;
+      }
+      _blocks = blocks;
+      _maxBlocks *= 2;
+    }
+    _blocks[_numBlocks++] = block;
+  }
+  void pop_block() { free_block(_blocks[--_numBlocks]); }
+
+  // append an entry that is not set yet
+  void grow() {
+    const std::size_t offset = _size & OffsetMask;
+    if (offset == 0) {
+      // a short Trace only needs a small first block
+      push_block(create_block(_numBlocks == 0 ? 1 : BlockSize));
+    } else if (offset == _blocks[_numBlocks - 1]->capacity()) {
+      Block *block = _blocks[_numBlocks - 1];
+      Block *larger = create_block(2 * block->capacity());
+      for (std::size_t i = 0; i < offset; ++i) {
+        larger->leaders()[i] = block->leaders()[block->slot(i)];
+        larger->frames()[i] = block->frames()[block->slot(i)];
+      }
+      free_block(block);
+      _blocks[_numBlocks - 1] = larger;
+    }
+    ++_size;
+  }
+
+  // drop the last count entries
+  void shrink(std::size_t count) {
+    _size -= count;
+    const std::size_t numBlocks = (_size + OffsetMask) >> BlockBits;
+    while (_numBlocks > numBlocks) {
+      pop_block();
+    }
+  }
+
+  // the frames open_one and close_one move at most
+  std::size_t cost_of_one() const { return BlockSize + _numBlocks; }
+
+  // make room for count entries at pos, they are not set
+  void open(std::size_t pos, std::size_t count) {
+    if (count * cost_of_one() < _size - pos) {
+      for (std::size_t i = 0; i < count; ++i) {
+        open_one(pos);
+      }
+      return;
+    }
+    const std::size_t oldSize = _size;
+    for (std::size_t i = 0; i < count; ++i) {
+      grow();
+    }
+    for (std::size_t i = oldSize; i-- > pos;) {
+      move(i, i + count);
+    }
+  }
+
+  // remove the count entries at pos
+  void close(std::size_t pos, std::size_t count) {
+    if (count * cost_of_one() < _size - pos - count) {
+      for (std::size_t i = 0; i < count; ++i) {
+        close_one(pos);
+      }
+      return;
+    }
+    for (std::size_t i = pos + count; i < _size; ++i) {
+      move(i, i - count);
+    }
+    shrink(count);
+  }
+
+  /**
+   * Each block after the one of pos takes over the last entry of its
+   * predecessor. Rotating the ring buffer by one moves all its entries one
+   * position back and frees the first one for it. Within the block of pos
+   * the shorter side of pos is moved.
+   **/
+  void open_one(std::size_t pos) {
+    grow();
+    const std::size_t first = pos >> BlockBits;
+    for (std::size_t i = _numBlocks - 1; i > first; --i) {
+      rotate(_blocks[i], -1);
+      move((i << BlockBits) - 1, i << BlockBits);
+    }
+
+    // the last entry of the block is free now
+    Block *block = _blocks[first];
+    const std::size_t offset = pos & OffsetMask;
+    const std::size_t last = std::min(_size - pos, BlockSize - offset) - 1;
+    if (offset < last) {
+      rotate(block, -1);
+      for (std::size_t i = 0; i < offset; ++i) {
+        move_slot(block, i + 1, i);
+      }
+    } else {
+      for (std::size_t i = offset + last; i > offset; --i) {
+        move_slot(block, i - 1, i);
+      }
+    }
+  }
+
+  void close_one(std::size_t pos) {
+    const std::size_t first = pos >> BlockBits;
+    Block *block = _blocks[first];
+    const std::size_t offset = pos & OffsetMask;
+    const std::size_t last = std::min(_size - pos, BlockSize - offset) - 1;
+    if (offset < last) {
+      for (std::size_t i = offset; i > 0; --i) {
+        move_slot(block, i - 1, i);
+      }
+      rotate(block, 1);
+    } else {
+      for (std::size_t i = offset; i < offset + last; ++i) {
+        move_slot(block, i + 1, i);
+      }
+    }
+
+    // the last entry of the block is free now
+    for (std::size_t i = first + 1; i < _numBlocks; ++i) {
+      move(i << BlockBits, (i << BlockBits) - 1);
+      rotate(_blocks[i], 1);
+    }
+    shrink(1);
+  }
+
+  // move the first slot of block by count
+  static void rotate(Block *block, std::ptrdiff_t count) {
+    block->head = (block->head + count) & block->mask;
+  }
+
+  static void move_slot(Block *block, std::size_t from, std::size_t to) {
+    const std::size_t fromSlot = block->slot(from);
+    const std::size_t toSlot = block->slot(to);
+    block->leaders()[toSlot] = block->leaders()[fromSlot];
+    block->frames()[toSlot] = block->frames()[fromSlot];
+  }
+
+  Frame const *decompressed(std::size_t pos) const {
+    for (unsigned i = 0; i < NumCached; ++i) {
+      if (_cached[i] == pos) {
+        return _cache[i];
+      }
+    }
+
+    unsigned slot = _nextCache;
+    _nextCache = (_nextCache + 1) % NumCached;
+    if (_cache[slot] == NULL) {
+      // values of every form fit into a general frame
+      _cache[slot] =
+          new (::operator new(Frame::storage_size(false))) Frame(false);
+    }
+    compressed_of(frame_at(pos))->decompress(leader_at(pos), *_cache[slot]);
+    _cached[slot] = pos;
+    return _cache[slot];
+  }
+
+  void invalidate_cache() {
+    for (unsigned i = 0; i < NumCached; ++i) {
+      _cached[i] = NotCached;
+    }
+  }
+
+  // the table of the blocks starts out as _firstBlock
+  Block **_blocks;
+  std::size_t _numBlocks;
+  std::size_t _maxBlocks;
+  Block *_firstBlock;
+  PackedDeltaTime _embeddedBlock[EmbeddedBlockWords];
+  std::size_t _size;
+  std::size_t _numCompressed;
+
+  mutable Frame *_cache[NumCached];
+  mutable std::size_t _cached[NumCached];
+  mutable unsigned _nextCache;
+};
+
+typedef BasicTraceFrameSeq<TraceFrameSize> TraceFrameSeq;
+
+} // namespace svt
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Bit.h"
+#include "TraceFwd.h"
+
+#include <boost/array.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace svt {
+
+/**
+ * Storage for the values of a frame, positions outside of the used part
+ * of the frame have unspecified values.
+ *
+ * Specialized for every TraceValueEncoding, all provide the same
+ * interface:
+ *   fits(value): true if value can be stored
+ *   get(pos), set(pos, value)
+ *   move(first, last, dest): move [first, last) to dest, the ranges may
+ *                            overlap
+ *   copy(first, last, other, dest): copy [first, last) to dest in other
+ *   decode(first, count, out): write count values starting at first to out
+ *
+ * TraceFrameToggles provides the same interface for the frames of two-state
+ * Traces.
+ **/
+template <unsigned FrameSize, TraceValueEncoding Encoding>
+class TraceFrameValues;
+
+template <unsigned FrameSize>
+class TraceFrameValues<FrameSize, TRACE_VALUES_BYTE> {
+public:
+  static bool fits(Bit) { return true; }
+
+  Bit get(unsigned pos) const { return _values[pos]; }
+  void set(unsigned pos, Bit value) { _values[pos] = value; }
+
+  void move(unsigned first, unsigned last, unsigned dest) {
+    std::memmove(_values.data() + dest, _values.data() + first, last - first);
+  }
+
+  void copy(unsigned first, unsigned last, TraceFrameValues &other,
+            unsigned dest) const {
+    std::copy(_values.begin() + first, _values.begin() + last,
+              other._values.begin() + dest);
+  }
+
+  void decode(unsigned first, unsigned count, Bit *out) const {
+    std::copy(_values.begin() + first, _values.begin() + first + count, out);
+  }
+
+private:
+  boost::array<Bit, FrameSize> _values;
+};
+
+/**
+ * Two values per byte, the value at an even position is stored in the low
+ * nibble. Only values below 16 can be stored, which covers the 9 values of
+ * std_logic.
+ **/
+template <unsigned FrameSize>
+class TraceFrameValues<FrameSize, TRACE_VALUES_NIBBLE> {
+public:
+  static bool fits(Bit value) { return value < 16; }
+
+  Bit get(unsigned pos) const {
+    return (_bytes[pos / 2] >> shift(pos)) & 0x0f;
+  }
+
+  void set(unsigned pos, Bit value) {
+    assert(fits(value) && "value does not fit into a nibble");
+    uint8_t &byte = _bytes[pos / 2];
+    byte = (byte & ~(0x0f << shift(pos))) | (value << shift(pos));
+  }
+
+  void move(unsigned first, unsigned last, unsigned dest) {
+    if (first == last) {
+      return;
+    }
+    if (first % 2 == 0 && dest % 2 == 0) {
+      // whole bytes, a trailing odd value only touches the low nibble
+      Bit trailing = get(last - 1);
+      std::memmove(_bytes.data() + dest / 2, _bytes.data() + first / 2,
+                   (last - first) / 2);
+      if ((last - first) % 2 != 0) {
+        set(dest + last - first - 1, trailing);
+      }
+    } else if (dest < first) {
+      for (unsigned i = first; i < last; ++i) {
+        set(dest + i - first, get(i));
+      }
+    } else {
+      for (unsigned i = last; i > first; --i) {
+        set(dest + i - 1 - first, get(i - 1));
+      }
+    }
+  }
+
+  void copy(unsigned first, unsigned last, TraceFrameValues &other,
+            unsigned dest) const {
+    for (unsigned i = first; i < last; ++i) {
+      other.set(dest + i - first, get(i));
+    }
+  }
+
+  void decode(unsigned first, unsigned count, Bit *out) const {
+    unsigned pos = first;
+    unsigned end = first + count;
+    if (pos < end && pos % 2 != 0) {
+      *out++ = get(pos++);
+    }
+#if defined(__SSE2__)
+    // 16 bytes expand to 32 values
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for (; pos + 32 <= end; pos += 32) {
+      __m128i packed =
+          _mm_loadu_si128(reinterpret_cast<__m128i const *>(&_bytes[pos / 2]));
+      __m128i low = _mm_and_si128(packed, mask);
+      __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                       _mm_unpacklo_epi8(low, high));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16),
+                       _mm_unpackhi_epi8(low, high));
+      out += 32;
+    }
+#endif
+    for (; pos + 2 <= end; pos += 2) {
+      uint8_t byte = _bytes[pos / 2];
+      *out++ = byte & 0x0f;
+      *out++ = byte >> 4;
+    }
+    if (pos < end) {
+      *out++ = get(pos);
+    }
+  }
+
+private:
+  static unsigned shift(unsigned pos) { return (pos % 2) * 4; }
+
+  boost::array<uint8_t, (FrameSize + 1) / 2> _bytes;
+};
+
+/**
+ * The values of a frame whose checkpoints alternate between two values, only
+ * the values at even and at odd positions are stored. Setting a value sets
+ * it for all positions of the same parity, moving entries by an odd distance
+ * swaps the two. The entries before the moved range read wrong values until
+ * the frame alternates again (e.g. after a second erase).
+ **/
+class TraceFrameToggles {
+public:
+  Bit get(unsigned pos) const { return _values[pos % 2]; }
+  void set(unsigned pos, Bit value) { _values[pos % 2] = value; }
+
+  void move(unsigned first, unsigned last, unsigned dest) {
+    if (first != last && (first - dest) % 2 != 0) {
+      std::swap(_values[0], _values[1]);
+    }
+  }
+
+  void copy(unsigned first, unsigned last, TraceFrameToggles &other,
+            unsigned dest) const {
+    if (first != last) {
+      other.set(dest, get(first));
+      other.set(dest + 1, get(first + 1));
+    }
+  }
+
+  void decode(unsigned first, unsigned count, Bit *out) const {
+    const Bit even = get(first);
+    const Bit odd = get(first + 1);
+    const Bit pattern[8] = {even, odd, even, odd, even, odd, even, odd};
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+      std::memcpy(out + i, pattern, 8);
+    }
+    for (; i < count; ++i) {
+      out[i] = pattern[i % 2];
+    }
+  }
+
+private:
+  Bit _values[2];
+};
+
+} // namespace svt
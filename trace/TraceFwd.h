@@ -3,8 +3,56 @@
 #include <boost/intrusive_ptr.hpp>
 
 namespace svt {
-class Trace;
+
+/**
+ * Number of entries per frame of the default Trace. BasicTrace is
+ * instantiated for the powers of two from 16 to 1024.
+ **/
+const unsigned TraceFrameSize = 32;
+
+/**
+ * How the values of the checkpoints are stored in a frame.
+ **/
+enum TraceValueEncoding {
+  /**
+   * One byte per value, any Bit can be stored.
+   **/
+  TRACE_VALUES_BYTE = 0,
+
+  /**
+   * Two values per byte, values must be below 16. Enough for the 9 values
+   * of std_logic.
+   **/
+  TRACE_VALUES_NIBBLE = 1,
+};
+
+template <unsigned FrameSize, TraceValueEncoding Encoding = TRACE_VALUES_BYTE>
+class BasicTraceFrame;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding = TRACE_VALUES_BYTE>
+class BasicTraceFramePool;
+
+class CompressedTraceFrame;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding = TRACE_VALUES_BYTE>
+class BasicTraceFrameSeq;
+
+template <unsigned FrameSize, TraceValueEncoding Encoding = TRACE_VALUES_BYTE>
+class BasicTrace;
+
+typedef BasicTrace<TraceFrameSize> Trace;
+
+/**
+ * A Trace storing two values per byte, only values below 16 can be written.
+ **/
+typedef BasicTrace<TraceFrameSize, TRACE_VALUES_NIBBLE> NibbleTrace;
 
 typedef boost::intrusive_ptr<Trace> TracePtr;
 
+template <class Trace> class BasicTraceSet;
+
+template <class Trace> class BasicTraceStore;
+
+template <class Trace> class BasicVersionedTrace;
+
 } // namespace svt
@@ -0,0 +1,66 @@
+#include "TraceMerge.h"
+
+#include <trace/Trace.h>
+
+#include <cassert>
+
+namespace svt {
+
+template <class Trace>
+std::size_t BasicTraceMerge<Trace>::add(Trace const &trace) {
+  _traces.push_back(&trace);
+  _iterators.push_back(trace.begin());
+  if (_iterators.back() != trace.end()) {
+    _next.push(_iterators.back().time().packed(), _traces.size() - 1);
+  }
+  return _traces.size() - 1;
+}
+
+template <class Trace>
+void BasicTraceMerge<Trace>::seek(DeltaTime const &time) {
+  // iterators can not be assigned, they are all created again
+  std::vector<Iterator> iterators;
+  iterators.reserve(_traces.size());
+  _next.clear();
+  _next.reserve(_traces.size());
+  for (std::size_t i = 0; i < _traces.size(); ++i) {
+    iterators.push_back(_traces[i]->lowerBound(time));
+    if (iterators.back() != _traces[i]->end()) {
+      _next.push(iterators.back().time().packed(), i);
+    }
+  }
+  _iterators.swap(iterators);
+}
+
+template <class Trace> DeltaTime BasicTraceMerge<Trace>::nextTime() const {
+  assert(!done());
+  return DeltaTime::fromPacked(_next.top_time());
+}
+
+template <class Trace>
+std::size_t BasicTraceMerge<Trace>::read(TraceEvent *events,
+                                         std::size_t count) {
+  std::size_t n = 0;
+  for (; n < count && !_next.empty(); ++n) {
+    const std::size_t signal = _next.top_signal();
+    Iterator &it = _iterators[signal];
+
+    TraceEvent &event = events[n];
+    event.signal = signal;
+    event.time = DeltaTime::fromPacked(_next.top_time());
+    event.value = it.value();
+
+    ++it;
+    if (it != _traces[signal]->end()) {
+      _next.replace_top(it.time().packed(), signal);
+    } else {
+      _next.pop();
+    }
+  }
+  return n;
+}
+
+template class BasicTraceMerge<Trace>;
+template class BasicTraceMerge<NibbleTrace>;
+
+} // namespace svt
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+#include <trace/MergeHeap.h>
+#include <trace/TraceFwd.h>
+
+#include <vector>
+
+namespace svt {
+
+/**
+ * A checkpoint of the signal with the given index.
+ **/
+struct TraceEvent {
+  std::size_t signal;
+  DeltaTime time;
+  Bit value;
+};
+
+/**
+ * Merges the checkpoints of many Traces into a single stream of events in
+ * time order.
+ *
+ * The merge keeps a const_iterator per Trace and a MergeHeap of the times
+ * of their next checkpoints, so an event costs a sift down of the heap,
+ * independent of the number of signals that do not change. Events at the
+ * same time come in no particular order.
+ *
+ * The Traces must not change while they are merged.
+ **/
+template <class Trace> class BasicTraceMerge {
+public:
+  BasicTraceMerge() {}
+
+  /**
+   * add a signal, returns its index. The merge of the new signal starts at
+   * its first checkpoint.
+   **/
+  std::size_t add(Trace const &trace);
+
+  std::size_t size() const { return _traces.size(); }
+
+  // continue the merge of all signals at their first checkpoint at or after
+  // time
+  void seek(DeltaTime const &time);
+
+  // true if all events were read
+  bool done() const { return _next.empty(); }
+
+  // the time of the next event, done() must be false
+  DeltaTime nextTime() const;
+
+  /**
+   * Read up to count events into events, returns the number of events
+   * read. Less than count are only read at the end of the merge.
+   **/
+  std::size_t read(TraceEvent *events, std::size_t count);
+
+private:
+  // disabled
+  BasicTraceMerge(const BasicTraceMerge &other);
+  BasicTraceMerge &operator=(const BasicTraceMerge &other);
+
+  typedef typename Trace::const_iterator Iterator;
+
+  std::vector<Trace const *> _traces;
+  std::vector<Iterator> _iterators;
+  MergeHeap _next;
+};
+
+typedef BasicTraceMerge<Trace> TraceMerge;
+typedef BasicTraceMerge<NibbleTrace> NibbleTraceMerge;
+
+} // namespace svt
@@ -0,0 +1,252 @@
+#include "TraceSet.h"
+
+#include <trace/FrameSearch.h>
+#include <trace/Trace.h>
+#include <trace/TraceFrameImpl.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace svt {
+
+namespace {
+
+// orders the indices of times by their time
+class TimeOrder {
+public:
+  explicit TimeOrder(std::vector<DeltaTime> const &times) : _times(times) {}
+
+  bool operator()(std::size_t a, std::size_t b) const {
+    return _times[a] < _times[b];
+  }
+
+private:
+  std::vector<DeltaTime> const &_times;
+};
+}
+
+template <class Trace>
+const Time BasicTraceSet<Trace>::DefaultBlockCycles;
+template <class Trace> const uint32_t BasicTraceSet<Trace>::NoNext;
+
+template <class Trace>
+BasicTraceSet<Trace>::BasicTraceSet(Time blockCycles)
+    : _blockCycles(blockCycles), _pool(new typename Trace::FramePool()),
+      _indexed(false), _numRows(0), _lastRow(0) {
+  assert(blockCycles > 0);
+}
+
+template <class Trace>
+std::size_t BasicTraceSet<Trace>::add(Bit const &initvalue) {
+  _traces.push_back(Ptr(new Trace(initvalue, _pool)));
+  _indexed = false;
+  return _traces.size() - 1;
+}
+
+template <class Trace>
+Trace &BasicTraceSet<Trace>::modify(std::size_t signal) {
+  _indexed = false;
+  return *_traces[signal];
+}
+
+template <class Trace>
+void BasicTraceSet<Trace>::append(std::size_t signal, Bit const &value,
+                                  DeltaTime const &time) {
+  Trace &trace = *_traces[signal];
+  if (trace.hasCheckpoints() && time <= trace.lastCheckpoint()) {
+    // falls back to set(), which may move the checkpoints between frames
+    _indexed = false;
+  } else if (_indexed) {
+    // the positions stay valid, but from the row of time on the entries
+    // do not know the new checkpoint, those rows are built again
+    std::size_t row = row_of(time.packed());
+    _lastRow = std::max(_lastRow, row);
+    _numRows = std::min(_numRows, row);
+  }
+  trace.appendMonotonic(value, time);
+}
+
+template <class Trace>
+void BasicTraceSet<Trace>::valuesAt(DeltaTime const &time, Bit *values) const {
+  if (_traces.empty()) {
+    return;
+  }
+  PackedDeltaTime t = time.packed();
+  std::size_t row = index_row(t);
+  PackedDeltaTime begin = row_begin(row);
+
+  Position const *entries = &_index[row * _traces.size()];
+  for (std::size_t i = 0; i < _traces.size(); ++i) {
+    values[i] = value_at(*_traces[i], entries[i], begin, t);
+  }
+}
+
+template <class Trace>
+std::vector<Bit> BasicTraceSet<Trace>::valuesAt(DeltaTime const &time) const {
+  std::vector<Bit> values(_traces.size());
+  valuesAt(time, values.data());
+  return values;
+}
+
+template <class Trace>
+std::vector<Bit>
+BasicTraceSet<Trace>::snapshots(std::vector<DeltaTime> const &times) const {
+  const std::size_t numSignals = _traces.size();
+  std::vector<Bit> values(times.size() * numSignals);
+  if (times.empty() || numSignals == 0) {
+    return values;
+  }
+
+  std::vector<std::size_t> order(times.size());
+  for (std::size_t j = 0; j < order.size(); ++j) {
+    order[j] = j;
+  }
+  std::sort(order.begin(), order.end(), TimeOrder(times));
+
+  std::vector<std::size_t> rows(times.size());
+  index_row(times[order.back()].packed());
+  for (std::size_t j = 0; j < times.size(); ++j) {
+    rows[j] = index_row(times[j].packed());
+  }
+
+  for (std::size_t i = 0; i < numSignals; ++i) {
+    Trace const &trace = *_traces[i];
+    std::size_t row = rows[order[0]];
+    Position position = _index[row * numSignals + i];
+    PackedDeltaTime begin = row_begin(row);
+    for (std::size_t j = 0; j < order.size(); ++j) {
+      std::size_t k = order[j];
+      PackedDeltaTime t = times[k].packed();
+      // a later row starts after the checkpoints read so far
+      if (rows[k] > row) {
+        row = rows[k];
+        position = _index[row * numSignals + i];
+        begin = row_begin(row);
+      }
+      if (t - begin >= position.next) {
+        advance(trace, position, t);
+        // the entry is used up, the curser goes on from here
+        position.next = 0;
+      }
+      values[k * numSignals + i] = position.value;
+    }
+  }
+  return values;
+}
+
+template <class Trace>
+std::size_t BasicTraceSet<Trace>::row_of(PackedDeltaTime time) const {
+  return DeltaTime::fromPacked(time).simcycle() / _blockCycles;
+}
+
+template <class Trace>
+PackedDeltaTime BasicTraceSet<Trace>::row_begin(std::size_t row) const {
+  return DeltaTime(row * _blockCycles, 0).packed();
+}
+
+template <class Trace>
+std::size_t BasicTraceSet<Trace>::index_row(PackedDeltaTime time) const {
+  const std::size_t numSignals = _traces.size();
+  if (!_indexed) {
+    _lastRow = 0;
+    for (std::size_t i = 0; i < numSignals; ++i) {
+      if (_traces[i]->hasCheckpoints()) {
+        _lastRow = std::max(_lastRow,
+                            row_of(_traces[i]->lastCheckpoint().packed()));
+      }
+    }
+    _numRows = 0;
+    _indexed = true;
+  }
+
+  const std::size_t row = std::min(row_of(time), _lastRow);
+  if (row < _numRows) {
+    return row;
+  }
+
+  _index.resize((row + 1) * numSignals);
+  // every row continues from the previous one
+  for (; _numRows <= row; ++_numRows) {
+    PackedDeltaTime begin = row_begin(_numRows);
+    Position *positions = &_index[_numRows * numSignals];
+    for (std::size_t i = 0; i < numSignals; ++i) {
+      Trace const &trace = *_traces[i];
+      Position &position = positions[i];
+      if (_numRows == 0) {
+        position.frame = 0;
+        position.pos = 0;
+        position.value = trace.getInitvalue();
+      } else {
+        position = positions[i - numSignals];
+        advance(trace, position, begin - 1);
+      }
+
+      // the checkpoint at the curser, frames before it may be empty
+      typename Trace::FrameSeq const &frames = trace._frames;
+      while (position.pos == frames.num_used(position.frame) &&
+             position.frame + 1 < frames.size()) {
+        ++position.frame;
+        position.pos = 0;
+      }
+      position.next = NoNext;
+      if (position.pos < frames.num_used(position.frame)) {
+        PackedDeltaTime next = frames[position.frame]->time_at(position.pos);
+        if (next - begin < NoNext) {
+          position.next = static_cast<uint32_t>(next - begin);
+        }
+      }
+    }
+  }
+  return row;
+}
+
+template <class Trace>
+void BasicTraceSet<Trace>::advance(Trace const &trace, Position &position,
+                                   PackedDeltaTime time) {
+  typedef typename Trace::Frame Frame;
+  typename Trace::FrameSeq const &frames = trace._frames;
+
+  // an exhausted position stays at the end of the last frame, where it
+  // still points to the checkpoints appended later
+  for (;;) {
+    unsigned pos = position.pos;
+    if (pos < frames.num_used(position.frame)) {
+      Frame const *frame = frames[position.frame];
+      const unsigned used = frame->num_used();
+      if (frame->time_at(pos) > time) {
+        return;
+      }
+      if (frame->time_at(used - 1) > time) {
+        // the first checkpoint after time is in this frame
+        pos += frame_lower_bound(frame->begin() + pos, used - pos, time + 1);
+        position.value = frame->bit_at(pos - 1);
+        position.pos = pos;
+        return;
+      }
+      position.value = frame->bit_at(used - 1);
+      position.pos = used;
+    }
+    if (position.frame + 1 >= frames.size()) {
+      return;
+    }
+    ++position.frame;
+    position.pos = 0;
+  }
+}
+
+template <class Trace>
+Bit BasicTraceSet<Trace>::value_at(Trace const &trace, Position const &entry,
+                                   PackedDeltaTime begin,
+                                   PackedDeltaTime time) {
+  if (time - begin < entry.next) {
+    return entry.value;
+  }
+  Position position = entry;
+  advance(trace, position, time);
+  return position.value;
+}
+
+template class BasicTraceSet<Trace>;
+template class BasicTraceSet<NibbleTrace>;
+
+} // namespace svt
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+#include <trace/TraceFwd.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace svt {
+
+/**
+ * A collection of signals on a shared time axis, answering queries for the
+ * values of all signals at once.
+ *
+ * The Traces of the signals share one frame pool. Next to them the set
+ * keeps a coarse time index: the simcycles are divided into blocks of
+ * blockCycles and for every block and signal the index holds the position
+ * of the first checkpoint at or after the start of the block and the value
+ * before it. The entries of a block are contiguous, so a time slice reads
+ * one row of the index and then only the frames of the signals that change
+ * between the start of the block and the requested time, without searching
+ * any Trace. The index has a row for every block up to the last checkpoint
+ * of all signals, blockCycles should be chosen so that a signal changes at
+ * most a few times per block.
+ *
+ * The index is built by the queries on demand and kept by append(), add()
+ * and modify() drop it. As the queries change the index they must not run
+ * in several threads at once.
+ **/
+template <class Trace> class BasicTraceSet {
+public:
+  static const Time DefaultBlockCycles = 1 << 10;
+
+  explicit BasicTraceSet(Time blockCycles = DefaultBlockCycles);
+
+  // add a signal with an empty Trace, returns the index of the signal
+  std::size_t add(Bit const &initvalue);
+
+  std::size_t size() const { return _traces.size(); }
+  Trace const &operator[](std::size_t signal) const {
+    return *_traces[signal];
+  }
+
+  // write access to the Trace of signal, drops the index
+  Trace &modify(std::size_t signal);
+
+  /**
+   * appendMonotonic to the Trace of signal. Appending after the last
+   * checkpoint of the signal keeps the index, otherwise it is dropped.
+   **/
+  void append(std::size_t signal, Bit const &value, DeltaTime const &time);
+
+  // values[i] = (*this)[i].get(time) for every signal i
+  void valuesAt(DeltaTime const &time, Bit *values) const;
+  std::vector<Bit> valuesAt(DeltaTime const &time) const;
+
+  /**
+   * The values of all signals at several times, the values at times[j] are
+   * row j of the result: result[j * size() + i] = (*this)[i].get(times[j]).
+   * Every Trace is read once, in time order.
+   **/
+  std::vector<Bit> snapshots(std::vector<DeltaTime> const &times) const;
+
+private:
+  // disabled
+  BasicTraceSet(const BasicTraceSet &other);
+  BasicTraceSet &operator=(const BasicTraceSet &other);
+
+  typedef boost::intrusive_ptr<Trace> Ptr;
+
+  // a curser into a Trace and the value of the checkpoint before it. In
+  // the index next is the distance from the start of the block to the
+  // checkpoint at the curser, NoNext if it is too far or there is none.
+  struct Position {
+    uint32_t frame;
+    uint32_t next;
+    uint16_t pos;
+    Bit value;
+  };
+
+  static const uint32_t NoNext = ~uint32_t(0);
+
+  std::size_t row_of(PackedDeltaTime time) const;
+  PackedDeltaTime row_begin(std::size_t row) const;
+  // build the index up to the row of time, returns that row or the last
+  // row if the index ends before
+  std::size_t index_row(PackedDeltaTime time) const;
+  // move position over the checkpoints of trace up to and including time
+  static void advance(Trace const &trace, Position &position,
+                      PackedDeltaTime time);
+  // the value of trace at time, which is in the row of the entry
+  static Bit value_at(Trace const &trace, Position const &entry,
+                      PackedDeltaTime begin, PackedDeltaTime time);
+
+  Time _blockCycles;
+  typename Trace::FramePoolPtr _pool;
+  std::vector<Ptr> _traces;
+
+  // _numRows rows of size() entries, false if the index was dropped
+  mutable bool _indexed;
+  mutable std::vector<Position> _index;
+  mutable std::size_t _numRows;
+  // row of the last checkpoint of all signals
+  mutable std::size_t _lastRow;
+};
+
+typedef BasicTraceSet<Trace> TraceSet;
+typedef BasicTraceSet<NibbleTrace> NibbleTraceSet;
+
+} // namespace svt
@@ -0,0 +1,113 @@
+#include "TraceStore.h"
+
+#include <trace/Trace.h>
+
+#include <cassert>
+
+namespace svt {
+
+template <class Trace> BasicTraceStore<Trace>::BasicTraceStore() {}
+
+template <class Trace>
+std::size_t BasicTraceStore<Trace>::add(TracePtr const &trace) {
+  Signal signal = {trace, false};
+  lookup(signal);
+  _signals.push_back(signal);
+  return _signals.size() - 1;
+}
+
+template <class Trace>
+Trace &BasicTraceStore<Trace>::modify(std::size_t signal) {
+  Signal &theSignal = _signals[signal];
+  if (!theSignal.modified) {
+    Entry &entry = _entries[theSignal.trace.get()];
+    assert(entry.users > 0);
+    if (entry.users > 1) {
+      // the clone copies the frames it writes
+      --entry.users;
+      theSignal.trace = theSignal.trace->clone();
+    } else {
+      remove(theSignal.trace.get(), entry.fingerprint);
+    }
+    theSignal.modified = true;
+    _modified.push_back(signal);
+  }
+  return *theSignal.trace;
+}
+
+template <class Trace> void BasicTraceStore<Trace>::dedup() {
+  for (std::size_t i = 0; i < _modified.size(); ++i) {
+    Signal &signal = _signals[_modified[i]];
+    signal.modified = false;
+    lookup(signal);
+  }
+  _modified.clear();
+}
+
+template <class Trace>
+bool BasicTraceStore<Trace>::same(std::size_t a, std::size_t b) const {
+  Signal const &signalA = _signals[a];
+  Signal const &signalB = _signals[b];
+  if (signalA.trace == signalB.trace) {
+    return true;
+  }
+  if (!signalA.modified && !signalB.modified) {
+    return false;
+  }
+  return equal(*signalA.trace, *signalB.trace);
+}
+
+template <class Trace>
+bool BasicTraceStore<Trace>::equal(Trace const &a, Trace const &b) {
+  if (a.getInitvalue() != b.getInitvalue()) {
+    return false;
+  }
+  typename Trace::const_iterator itA = a.begin();
+  typename Trace::const_iterator const endA = a.end();
+  typename Trace::const_iterator itB = b.begin();
+  typename Trace::const_iterator const endB = b.end();
+  for (; itA != endA && itB != endB; ++itA, ++itB) {
+    if (itA.time() != itB.time() || itA.value() != itB.value()) {
+      return false;
+    }
+  }
+  return itA == endA && itB == endB;
+}
+
+template <class Trace> void BasicTraceStore<Trace>::lookup(Signal &signal) {
+  const uint64_t fingerprint = signal.trace->fingerprint();
+  typedef typename boost::unordered_multimap<uint64_t, Trace *>::iterator
+      Iterator;
+  std::pair<Iterator, Iterator> candidates =
+      _byFingerprint.equal_range(fingerprint);
+  for (Iterator it = candidates.first; it != candidates.second; ++it) {
+    if (equal(*it->second, *signal.trace)) {
+      signal.trace = it->second;
+      ++_entries[it->second].users;
+      return;
+    }
+  }
+  _byFingerprint.insert(std::make_pair(fingerprint, signal.trace.get()));
+  Entry entry = {fingerprint, 1};
+  _entries[signal.trace.get()] = entry;
+}
+
+template <class Trace>
+void BasicTraceStore<Trace>::remove(Trace *trace, uint64_t fingerprint) {
+  typedef typename boost::unordered_multimap<uint64_t, Trace *>::iterator
+      Iterator;
+  std::pair<Iterator, Iterator> candidates =
+      _byFingerprint.equal_range(fingerprint);
+  for (Iterator it = candidates.first; it != candidates.second; ++it) {
+    if (it->second == trace) {
+      _byFingerprint.erase(it);
+      break;
+    }
+  }
+  _entries.erase(trace);
+}
+
+template class BasicTraceStore<Trace>;
+template class BasicTraceStore<NibbleTrace>;
+
+} // namespace svt
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <trace/TraceFwd.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace svt {
+
+/**
+ * A collection of signals that keeps one Trace for all signals with the
+ * same checkpoints.
+ *
+ * Large designs contain many signals with identical waveforms: tied
+ * constants, copies of a net in its fanout, replicated clock and reset nets.
+ * The store finds an equal Trace by the fingerprint of a new one and lets
+ * the signal share it, so same() compares such signals in constant time and
+ * the checkpoints are kept once.
+ *
+ * A signal is written through modify(), which gives the signal a clone of
+ * its Trace first if other signals share it. The clone shares the frames
+ * and only copies the ones it writes. Modified signals are looked up again
+ * by dedup(); the fingerprint only reads the frames written since it was
+ * computed last.
+ *
+ * Equal means the same initial value and the same checkpoints. Traces that
+ * differ only in checkpoints not changing the value are equal by
+ * operator==, but not to the store.
+ **/
+template <class Trace> class BasicTraceStore {
+public:
+  typedef boost::intrusive_ptr<Trace> TracePtr;
+
+  BasicTraceStore();
+
+  /**
+   * add a signal with the checkpoints of trace, returns the index of the
+   * signal. The store keeps trace itself if it has no equal Trace yet,
+   * afterwards it must only be changed through modify().
+   **/
+  std::size_t add(TracePtr const &trace);
+
+  std::size_t size() const { return _signals.size(); }
+  Trace const &operator[](std::size_t signal) const {
+    return *_signals[signal].trace;
+  }
+  // the Trace of signal, which may be shared with other signals
+  TracePtr const &trace(std::size_t signal) const {
+    return _signals[signal].trace;
+  }
+
+  /**
+   * write access to the Trace of signal, which is not shared with other
+   * signals until the next dedup(). The reference is valid until then.
+   **/
+  Trace &modify(std::size_t signal);
+
+  // let the signals changed by modify() share equal Traces again
+  void dedup();
+
+  /**
+   * whether signals a and b have equal Traces, in constant time unless one
+   * of them was modified since the last dedup().
+   **/
+  bool same(std::size_t a, std::size_t b) const;
+
+  // the number of distinct Traces of the signals
+  std::size_t numTraces() const {
+    return _entries.size() + _modified.size();
+  }
+
+private:
+  // disabled
+  BasicTraceStore(const BasicTraceStore &other);
+  BasicTraceStore &operator=(const BasicTraceStore &other);
+
+  struct Signal {
+    TracePtr trace;
+    // not looked up since modify(), its Trace is not in the store
+    bool modified;
+  };
+
+  // a Trace in the store
+  struct Entry {
+    uint64_t fingerprint;
+    // the signals sharing the Trace
+    std::size_t users;
+  };
+
+  static bool equal(Trace const &a, Trace const &b);
+
+  // let signal share an equal Trace of the store or add its Trace
+  void lookup(Signal &signal);
+  // remove the Trace of an entry that is not used any more
+  void remove(Trace *trace, uint64_t fingerprint);
+
+  std::vector<Signal> _signals;
+  // the modified signals
+  std::vector<std::size_t> _modified;
+  boost::unordered_multimap<uint64_t, Trace *> _byFingerprint;
+  boost::unordered_map<Trace *, Entry> _entries;
+};
+
+typedef BasicTraceStore<Trace> TraceStore;
+typedef BasicTraceStore<NibbleTrace> NibbleTraceStore;
+
+} // namespace svt
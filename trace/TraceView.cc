@@ -0,0 +1,105 @@
+#include "TraceView.h"
+
+#include <trace/FrameSearch.h>
+
+#include <algorithm>
+
+namespace svt {
+
+TraceView::TraceView(Bit const &initvalue)
+    : _times(NULL), _values(NULL), _size(0), _leaders(NULL), _numFrames(0),
+      _frameSize(1), _initvalue(initvalue) {}
+
+TraceView::TraceView(PackedDeltaTime const *times, Bit const *values,
+                     std::size_t size, PackedDeltaTime const *leaders,
+                     unsigned frameSize, Bit const &initvalue)
+    : _times(times), _values(values), _size(size), _leaders(leaders),
+      _numFrames((size + frameSize - 1) / frameSize), _frameSize(frameSize),
+      _initvalue(initvalue) {}
+
+std::size_t TraceView::lower_bound(PackedDeltaTime time) const {
+  // the last frame starting at or before time
+  std::size_t frame =
+      std::upper_bound(_leaders, _leaders + _numFrames, time) - _leaders;
+  if (frame == 0) {
+    return 0;
+  }
+  --frame;
+
+  std::size_t first = frame * _frameSize;
+  unsigned count = static_cast<unsigned>(
+      std::min<std::size_t>(_size - first, _frameSize));
+  return first + frame_lower_bound(_times + first, count, time);
+}
+
+Bit TraceView::value_before(std::size_t index) const {
+  return index > 0 ? _values[index - 1] : _initvalue;
+}
+
+Bit TraceView::get(const DeltaTime &time) const {
+  std::size_t index = lower_bound(time.packed());
+  if (index < _size && _times[index] == time.packed()) {
+    return _values[index];
+  }
+  return value_before(index);
+}
+
+DeltaTime TraceView::checkpoint(const DeltaTime &time) const {
+  std::size_t index = lower_bound(time.packed());
+  if (index < _size && _times[index] == time.packed()) {
+    return time;
+  }
+  if (index > 0) {
+    return DeltaTime::fromPacked(_times[index - 1]);
+  }
+  return DeltaTime(0, 0);
+}
+
+DeltaTime TraceView::firstCheckpoint() const {
+  return _size > 0 ? DeltaTime::fromPacked(_times[0]) : DeltaTime(0, 0);
+}
+
+DeltaTime TraceView::lastCheckpoint() const {
+  return _size > 0 ? DeltaTime::fromPacked(_times[_size - 1])
+                   : DeltaTime(0, 0);
+}
+
+boost::optional<DeltaTime>
+TraceView::prevCheckpoint(DeltaTime const &baseTime) const {
+  std::size_t index = lower_bound(baseTime.packed());
+  if (index == 0) {
+    return boost::none;
+  }
+  return DeltaTime::fromPacked(_times[index - 1]);
+}
+
+boost::optional<DeltaTime>
+TraceView::nextCheckpoint(DeltaTime const &baseTime) const {
+  std::size_t index = lower_bound(baseTime.packed());
+  if (index < _size && _times[index] == baseTime.packed()) {
+    ++index;
+  }
+  if (index == _size) {
+    return boost::none;
+  }
+  return DeltaTime::fromPacked(_times[index]);
+}
+
+bool TraceView::changed(const DeltaTime &time) const {
+  // the checkpoint defining the value at time, index - 1 if it is before
+  std::size_t index = lower_bound(time.packed());
+  if (index < _size && _times[index] == time.packed()) {
+    ++index;
+  }
+  Bit currentVal = value_before(index);
+
+  while (index > 0 &&
+         DeltaTime::fromPacked(_times[index - 1]).simcycle() ==
+             time.simcycle()) {
+    --index;
+  }
+
+  return value_before(index) != currentVal;
+}
+
+} // namespace svt
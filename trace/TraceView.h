@@ -0,0 +1,99 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <utility>
+
+namespace svt {
+
+/**
+ * Read-only access to a Trace stored in a TraceFile, served directly from
+ * the mapped file.
+ *
+ * The checkpoints are kept in two contiguous arrays, every frameSize
+ * entries form a frame whose first time is repeated in the frame index.
+ * The read functions have the same results as those of BasicTrace. A view
+ * is only valid as long as the TraceFile it was taken from.
+ **/
+class TraceView {
+public:
+  class const_iterator {
+  public:
+    const_iterator &operator++() {
+      ++_pos;
+      return *this;
+    }
+    bool operator==(const_iterator const &other) const {
+      return _pos == other._pos;
+    }
+    bool operator!=(const_iterator const &other) const {
+      return _pos != other._pos;
+    }
+
+    typedef std::pair<DeltaTime, Bit> value_type;
+    value_type operator*() const { return value_type(time(), value()); }
+
+    DeltaTime time() const {
+      return DeltaTime::fromPacked(_view->_times[_pos]);
+    }
+    Bit value() const { return _view->_values[_pos]; }
+
+  private:
+    const_iterator(TraceView const *view, std::size_t pos)
+        : _view(view), _pos(pos) {}
+
+    TraceView const *_view;
+    std::size_t _pos;
+
+    friend class TraceView;
+  };
+
+  // a view of an empty Trace
+  explicit TraceView(Bit const &initvalue = 0);
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, _size); }
+
+  bool changed(const DeltaTime &time) const;
+
+  DeltaTime checkpoint(const DeltaTime &time) const;
+
+  DeltaTime firstCheckpoint() const;
+  DeltaTime lastCheckpoint() const;
+
+  bool hasCheckpoints() const { return _size != 0; }
+  std::size_t numberOfCheckpoints() const { return _size; }
+
+  boost::optional<DeltaTime> prevCheckpoint(DeltaTime const &baseTime) const;
+  boost::optional<DeltaTime> nextCheckpoint(DeltaTime const &baseTime) const;
+
+  Bit get(const DeltaTime &t) const;
+
+  Bit getInitvalue() const { return _initvalue; }
+
+private:
+  TraceView(PackedDeltaTime const *times, Bit const *values, std::size_t size,
+            PackedDeltaTime const *leaders, unsigned frameSize,
+            Bit const &initvalue);
+
+  // index of the first checkpoint not before time, _size if there is none
+  std::size_t lower_bound(PackedDeltaTime time) const;
+  // value of the checkpoint before index, the initvalue if there is none
+  Bit value_before(std::size_t index) const;
+
+  PackedDeltaTime const *_times;
+  Bit const *_values;
+  std::size_t _size;
+  PackedDeltaTime const *_leaders;
+  std::size_t _numFrames;
+  unsigned _frameSize;
+  Bit _initvalue;
+
+  friend class TraceFile;
+};
+
+} // namespace svt
@@ -0,0 +1,544 @@
+#include "Vcd.h"
+
+#include <trace/MergeHeap.h>
+#include <trace/Trace.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace svt {
+
+char const VcdValueChars[10] = "01XZUWLH-";
+
+Bit vcd_value(char c) {
+  switch (c) {
+  case '0':
+    return 0;
+  case '1':
+    return 1;
+  case 'X':
+  case 'x':
+    return 2;
+  case 'Z':
+  case 'z':
+    return 3;
+  case 'U':
+  case 'u':
+    return 4;
+  case 'W':
+  case 'w':
+    return 5;
+  case 'L':
+  case 'l':
+    return 6;
+  case 'H':
+  case 'h':
+    return 7;
+  case '-':
+    return 8;
+  default:
+    return NoVcdValue;
+  }
+}
+
+namespace {
+
+void fail(std::string const &what) {
+  throw std::runtime_error("invalid VCD: " + what);
+}
+
+bool is_space(char c) { return static_cast<unsigned char>(c) <= ' '; }
+
+// the printable characters allowed in identifiers
+const char FirstIdChar = '!';
+const char LastIdChar = '~';
+const unsigned IdChars = LastIdChar - FirstIdChar + 1;
+
+// the identifier of the signal at index, the shortest ones first
+std::string vcd_id(std::size_t index) {
+  std::string id;
+  do {
+    id += static_cast<char>(FirstIdChar + index % IdChars);
+    index /= IdChars;
+  } while (index-- > 0);
+  return id;
+}
+
+// collects the output in a buffer, written to the stream when it is full.
+// close() reports the errors, the destructor only writes the rest if an
+// exception left it unclosed.
+class VcdOutput {
+public:
+  explicit VcdOutput(std::ostream &out) : _out(out), _used(0) {}
+  ~VcdOutput() {
+    if (_used > 0) {
+      _out.write(_buffer, _used);
+    }
+  }
+
+  void put(char c) {
+    if (_used == BufferSize) {
+      flush();
+    }
+    _buffer[_used++] = c;
+  }
+
+  void put(std::string const &s) {
+    if (_used + s.size() > BufferSize) {
+      flush();
+    }
+    if (s.size() > BufferSize) {
+      write(s.data(), s.size());
+      return;
+    }
+    std::memcpy(_buffer + _used, s.data(), s.size());
+    _used += s.size();
+  }
+
+  void put_time(Time time) {
+    char digits[20];
+    unsigned count = 0;
+    do {
+      digits[count++] = static_cast<char>('0' + time % 10);
+      time /= 10;
+    } while (time != 0);
+    while (count > 0) {
+      put(digits[--count]);
+    }
+  }
+
+  void put_value(Bit value, std::string const &id) {
+    if (_used + id.size() + 2 > BufferSize) {
+      flush();
+    }
+    _buffer[_used] =
+        value < sizeof(VcdValueChars) - 1 ? VcdValueChars[value] : 'X';
+    std::memcpy(_buffer + _used + 1, id.data(), id.size());
+    _buffer[_used + id.size() + 1] = '\n';
+    _used += id.size() + 2;
+  }
+
+  void flush() {
+    const std::size_t used = _used;
+    _used = 0;
+    write(_buffer, used);
+  }
+
+  // write the buffer and flush the stream
+  void close() {
+    flush();
+    _out.flush();
+    if (!_out) {
+      throw std::runtime_error("cannot write VCD");
+    }
+  }
+
+private:
+  void write(char const *data, std::size_t size) {
+    _out.write(data, size);
+    if (!_out) {
+      throw std::runtime_error("cannot write VCD");
+    }
+  }
+
+  static const std::size_t BufferSize = 1 << 16;
+
+  std::ostream &_out;
+  char _buffer[BufferSize];
+  std::size_t _used;
+};
+
+} // namespace
+
+const std::size_t VcdReader::DefaultChunkSize;
+const unsigned VcdReader::NoSignal;
+
+bool VcdReader::Token::operator==(char const *keyword) const {
+  std::size_t length = std::strlen(keyword);
+  return size() == length && std::memcmp(begin, keyword, length) == 0;
+}
+
+VcdReader::VcdReader(std::istream &in, std::size_t chunkSize)
+    : _in(in), _buffer(std::max<std::size_t>(chunkSize, 1)), _pos(NULL),
+      _end(NULL), _eof(false) {
+  _pos = _end = &_buffer[0];
+  read_header();
+}
+
+bool VcdReader::refill() {
+  // keep the unread rest, grow the buffer if it is a single token
+  std::size_t rest = _end - _pos;
+  if (rest == _buffer.size()) {
+    std::vector<char> buffer(2 * _buffer.size());
+    std::memcpy(&buffer[0], _pos, rest);
+    _buffer.swap(buffer);
+  } else if (rest > 0) {
+    std::memmove(&_buffer[0], _pos, rest);
+  }
+
+  _in.read(&_buffer[rest], _buffer.size() - rest);
+  std::size_t count = _in.gcount();
+  _pos = &_buffer[0];
+  _end = _pos + rest + count;
+  if (count == 0) {
+    _eof = true;
+  }
+  return count > 0;
+}
+
+VcdReader::Token VcdReader::next() {
+  for (;;) {
+    while (_pos != _end && is_space(*_pos)) {
+      ++_pos;
+    }
+    if (_pos == _end) {
+      if (_eof || !refill()) {
+        Token token = {_end, _end};
+        return token;
+      }
+      continue;
+    }
+
+    char const *end = _pos;
+    while (end != _end && !is_space(*end)) {
+      ++end;
+    }
+    if (end == _end && !_eof) {
+      // the token may continue in the next chunk
+      refill();
+      continue;
+    }
+
+    Token token = {_pos, end};
+    _pos = end;
+    return token;
+  }
+}
+
+VcdReader::Token VcdReader::expect_token(char const *what) {
+  Token token = next();
+  if (token.empty()) {
+    fail(std::string("missing ") + what);
+  }
+  return token;
+}
+
+void VcdReader::skip_section() {
+  for (Token token = next(); !(token == "$end"); token = next()) {
+    if (token.empty()) {
+      fail("missing $end");
+    }
+  }
+}
+
+void VcdReader::read_header() {
+  std::vector<std::string> scopes;
+  for (;;) {
+    Token token = next();
+    if (token.empty()) {
+      fail("missing $enddefinitions");
+    } else if (token == "$scope") {
+      expect_token("scope type");
+      scopes.push_back(expect_token("scope name").str());
+      skip_section();
+    } else if (token == "$upscope") {
+      if (scopes.empty()) {
+        fail("$upscope without $scope");
+      }
+      scopes.pop_back();
+      skip_section();
+    } else if (token == "$var") {
+      read_var(scopes);
+    } else if (token == "$timescale") {
+      _timescale.clear();
+      for (token = next(); !(token == "$end"); token = next()) {
+        if (token.empty()) {
+          fail("missing $end");
+        }
+        _timescale += token.str();
+      }
+    } else if (token == "$enddefinitions") {
+      skip_section();
+      return;
+    } else if (*token.begin == '$') {
+      // $date, $version, $comment
+      skip_section();
+    } else {
+      fail("unexpected " + token.str() + " in header");
+    }
+  }
+}
+
+void VcdReader::read_var(std::vector<std::string> const &scopes) {
+  VcdSignal signal;
+  expect_token("var type");
+
+  std::string width = expect_token("var size").str();
+  signal.width = 0;
+  for (std::size_t i = 0; i < width.size(); ++i) {
+    if (width[i] < '0' || width[i] > '9') {
+      fail("invalid var size " + width);
+    }
+    signal.width = 10 * signal.width + (width[i] - '0');
+  }
+
+  signal.id = expect_token("var identifier").str();
+  for (std::size_t i = 0; i < scopes.size(); ++i) {
+    signal.name += scopes[i] + '.';
+  }
+  signal.name += expect_token("var reference").str();
+  // an optional bit select
+  for (Token token = next(); !(token == "$end"); token = next()) {
+    if (token.empty()) {
+      fail("missing $end");
+    }
+    signal.name += token.str();
+  }
+
+  add_id(signal.id, _signals.size());
+  _signals.push_back(signal);
+}
+
+uint64_t VcdReader::id_code(char const *begin, char const *end) {
+  if (static_cast<std::size_t>(end - begin) > MaxIdSize) {
+    return NoId;
+  }
+  // the digits are 1 to IdChars, so identifiers of different lengths
+  // differ
+  uint64_t code = 0;
+  for (char const *c = begin; c != end; ++c) {
+    if (*c < FirstIdChar || *c > LastIdChar) {
+      return NoId;
+    }
+    code = code * (IdChars + 1) + (*c - FirstIdChar + 1);
+  }
+  return code;
+}
+
+void VcdReader::add_id(std::string const &id, unsigned signal) {
+  uint64_t code = id_code(id.data(), id.data() + id.size());
+
+  unsigned first = NoSignal;
+  if (code < DirectIds) {
+    if (code >= _directIds.size()) {
+      _directIds.resize(code + 1, NoSignal);
+    }
+    first = _directIds[code];
+    if (first == NoSignal) {
+      _directIds[code] = signal;
+    }
+  } else if (code != NoId) {
+    first = _ids.insert(std::make_pair(code, signal)).first->second;
+  } else {
+    first = _longIds.insert(std::make_pair(id, signal)).first->second;
+  }
+
+  // an alias of an earlier signal goes to the end of its chain
+  _nextAlias.push_back(NoSignal);
+  if (first != signal && first != NoSignal) {
+    while (_nextAlias[first] != NoSignal) {
+      first = _nextAlias[first];
+    }
+    _nextAlias[first] = signal;
+  }
+}
+
+unsigned VcdReader::find_id(char const *begin, char const *end) const {
+  uint64_t code = id_code(begin, end);
+  if (code < _directIds.size()) {
+    return _directIds[code];
+  }
+  if (code != NoId) {
+    boost::unordered_map<uint64_t, unsigned>::const_iterator it =
+        _ids.find(code);
+    return it != _ids.end() ? it->second : NoSignal;
+  }
+  boost::unordered_map<std::string, unsigned>::const_iterator it =
+      _longIds.find(std::string(begin, end));
+  return it != _longIds.end() ? it->second : NoSignal;
+}
+
+template <class Trace>
+void VcdReader::read(std::vector<Trace *> const &traces) {
+  assert(traces.size() == _signals.size());
+
+  Time time = 0;
+  for (Token token = next(); !token.empty(); token = next()) {
+    char kind = *token.begin;
+    Bit value = NoVcdValue;
+
+    if (kind == '#') {
+      time = 0;
+      for (char const *c = token.begin + 1; c != token.end; ++c) {
+        if (*c < '0' || *c > '9') {
+          fail("invalid timestamp " + token.str());
+        }
+        const Time digit = *c - '0';
+        if (time > (DeltaTime::MaxSimTime - digit) / 10) {
+          fail("timestamp out of range " + token.str());
+        }
+        time = 10 * time + digit;
+      }
+      continue;
+    } else if (kind == '$') {
+      // the changes inside $dumpvars and the like are read as any other
+      if (token == "$comment") {
+        skip_section();
+      }
+      continue;
+    } else if (kind == 'b' || kind == 'B' || kind == 'r' || kind == 'R') {
+      // only vectors of a single bit are read, the token becomes invalid
+      // with the next one
+      if ((kind == 'b' || kind == 'B') && token.size() == 2) {
+        value = vcd_value(token.begin[1]);
+      }
+      token = expect_token("identifier");
+    } else {
+      value = vcd_value(kind);
+      if (value == NoVcdValue) {
+        fail("invalid value change " + token.str());
+      }
+      ++token.begin;
+    }
+
+    unsigned signal = find_id(token.begin, token.end);
+    if (signal == NoSignal) {
+      fail("unknown identifier " + token.str());
+    }
+    for (; signal != NoSignal; signal = _nextAlias[signal]) {
+      Trace *trace = traces[signal];
+      if (trace != NULL && value != NoVcdValue &&
+          _signals[signal].width == 1) {
+        trace->appendMonotonic(value, DeltaTime(time, 0));
+      }
+    }
+  }
+}
+
+template <class Trace>
+BasicVcdWriter<Trace>::BasicVcdWriter(std::ostream &out,
+                                      std::string const &timescale)
+    : _out(out), _timescale(timescale) {}
+
+template <class Trace>
+void BasicVcdWriter<Trace>::addSignal(std::string const &name,
+                                      Trace const &trace) {
+  _names.push_back(name);
+  _traces.push_back(&trace);
+}
+
+template <class Trace> void BasicVcdWriter<Trace>::write_header() {
+  VcdOutput out(_out);
+  out.put("$timescale " + _timescale + " $end\n");
+
+  std::vector<std::string> scopes;
+  for (std::size_t i = 0; i < _names.size(); ++i) {
+    std::vector<std::string> path;
+    std::string const &name = _names[i];
+    std::size_t begin = 0;
+    for (std::size_t dot = name.find('.'); dot != std::string::npos;
+         dot = name.find('.', begin)) {
+      path.push_back(name.substr(begin, dot - begin));
+      begin = dot + 1;
+    }
+
+    std::size_t common = 0;
+    while (common < scopes.size() && common < path.size() &&
+           scopes[common] == path[common]) {
+      ++common;
+    }
+    for (; scopes.size() > common; scopes.pop_back()) {
+      out.put("$upscope $end\n");
+    }
+    for (; scopes.size() < path.size(); scopes.push_back(path[scopes.size()])) {
+      out.put("$scope module " + path[scopes.size()] + " $end\n");
+    }
+
+    out.put("$var wire 1 " + vcd_id(i) + " " + name.substr(begin) +
+            " $end\n");
+  }
+  for (; !scopes.empty(); scopes.pop_back()) {
+    out.put("$upscope $end\n");
+  }
+  out.put("$enddefinitions $end\n");
+  out.close();
+}
+
+template <class Trace> void BasicVcdWriter<Trace>::write() {
+  typedef typename Trace::const_iterator Iterator;
+
+  write_header();
+
+  VcdOutput out(_out);
+  std::vector<std::string> ids;
+  std::vector<Iterator> iterators;
+  std::vector<Bit> written;
+  MergeHeap next;
+  iterators.reserve(_traces.size());
+  next.reserve(_traces.size());
+
+  // the values at the end of simcycle 0 are the initial ones
+  out.put("#0\n$dumpvars\n");
+  for (std::size_t i = 0; i < _traces.size(); ++i) {
+    ids.push_back(vcd_id(i));
+    iterators.push_back(_traces[i]->begin());
+    Iterator &it = iterators.back();
+    Iterator const end = _traces[i]->end();
+
+    Bit value = _traces[i]->getInitvalue();
+    for (; it != end && it.time().simcycle() == 0; ++it) {
+      value = it.value();
+    }
+    written.push_back(value);
+    out.put_value(value, ids[i]);
+    if (it != end) {
+      next.push(it.time().simcycle(), i);
+    }
+  }
+  out.put("$end\n");
+
+  Time current = 0;
+  while (!next.empty()) {
+    const Time simcycle = next.top_time();
+    const std::size_t i = next.top_signal();
+
+    Iterator &it = iterators[i];
+    Iterator const end = _traces[i]->end();
+    Bit value = it.value();
+    for (++it; it != end && it.time().simcycle() == simcycle; ++it) {
+      value = it.value();
+    }
+    if (it != end) {
+      next.replace_top(it.time().simcycle(), i);
+    } else {
+      next.pop();
+    }
+
+    // changes that were undone within the simcycle
+    if (value == written[i]) {
+      continue;
+    }
+    if (simcycle != current) {
+      out.put('#');
+      out.put_time(simcycle);
+      out.put('\n');
+      current = simcycle;
+    }
+    out.put_value(value, ids[i]);
+    written[i] = value;
+  }
+  out.close();
+}
+
+template void VcdReader::read(std::vector<Trace *> const &traces);
+template void VcdReader::read(std::vector<NibbleTrace *> const &traces);
+
+template class BasicVcdWriter<Trace>;
+template class BasicVcdWriter<NibbleTrace>;
+
+} // namespace svt
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+#include <trace/TraceFwd.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace svt {
+
+/**
+ * The std_logic values as they are written in a VCD file, the Bit of a
+ * value is its position. '0' and '1' keep their numeric value, so two-state
+ * Traces stay two-state. Reading also accepts lower case letters.
+ **/
+extern char const VcdValueChars[10];
+
+/**
+ * Bit of the std_logic value c, NoVcdValue if c is none.
+ **/
+const Bit NoVcdValue = 0xff;
+Bit vcd_value(char c);
+
+/**
+ * A variable declared in the header of a VCD file. name contains the
+ * enclosing scopes separated by '.'.
+ **/
+struct VcdSignal {
+  std::string name;
+  std::string id;
+  unsigned width;
+};
+
+/**
+ * Streaming reader of VCD files.
+ *
+ * The header is parsed on construction, read() then appends the value
+ * changes to one Trace per signal. The input is tokenized in place in a
+ * buffer of chunkSize bytes, so the memory used does not depend on the
+ * size of the file. The timestamps become the simcycles of the Traces,
+ * all changes are written at delta cycle 0; a later change of a signal at
+ * the same timestamp replaces the earlier one.
+ *
+ * Only scalar variables and vectors of width 1 are read, changes of wider
+ * vectors and of reals are skipped. Malformed input, including timestamps
+ * after DeltaTime::MaxSimTime, is reported by std::runtime_error.
+ **/
+class VcdReader {
+public:
+  static const std::size_t DefaultChunkSize = 1 << 20;
+
+  explicit VcdReader(std::istream &in,
+                     std::size_t chunkSize = DefaultChunkSize);
+
+  std::vector<VcdSignal> const &signals() const { return _signals; }
+  std::string const &timescale() const { return _timescale; }
+
+  /**
+   * Read all value changes, the changes of signals()[i] are appended to
+   * traces[i]. Signals without a Trace (NULL) are skipped.
+   **/
+  template <class Trace> void read(std::vector<Trace *> const &traces);
+
+private:
+  // disabled
+  VcdReader(const VcdReader &other);
+  VcdReader &operator=(const VcdReader &other);
+
+  struct Token {
+    char const *begin;
+    char const *end;
+
+    bool empty() const { return begin == end; }
+    std::size_t size() const { return end - begin; }
+    bool operator==(char const *keyword) const;
+    std::string str() const { return std::string(begin, end); }
+  };
+
+  // identifiers of up to MaxIdSize characters are looked up by their code,
+  // longer ones by their string
+  static const std::size_t MaxIdSize = 9;
+  static const uint64_t NoId = ~uint64_t(0);
+  static const uint64_t DirectIds = 94 * 94 * 94;
+  static const unsigned NoSignal = ~0u;
+
+  // the next whitespace separated token, empty at the end of the input.
+  // It is valid until the next call.
+  Token next();
+  bool refill();
+
+  void read_header();
+  void read_var(std::vector<std::string> const &scopes);
+  void skip_section();
+  Token expect_token(char const *what);
+
+  static uint64_t id_code(char const *begin, char const *end);
+  void add_id(std::string const &id, unsigned signal);
+  // first signal with the identifier, NoSignal if there is none
+  unsigned find_id(char const *begin, char const *end) const;
+
+  std::istream &_in;
+  std::vector<char> _buffer;
+  char const *_pos;
+  char const *_end;
+  bool _eof;
+
+  std::string _timescale;
+  std::vector<VcdSignal> _signals;
+  // signals sharing an identifier, in a chain starting at the first one
+  std::vector<unsigned> _nextAlias;
+  std::vector<unsigned> _directIds;
+  boost::unordered_map<uint64_t, unsigned> _ids;
+  boost::unordered_map<std::string, unsigned> _longIds;
+};
+
+/**
+ * Streaming writer of VCD files.
+ *
+ * write() merges the checkpoints of all signals by time and writes them as
+ * value changes. VCD has no delta cycles, only the value of a signal at the
+ * end of each simcycle is written. Values that are not std_logic are
+ * written as 'X'. Names are split at '.' into scopes. The memory used only
+ * depends on the number of signals. Errors writing or flushing the stream
+ * are reported by std::runtime_error.
+ **/
+template <class Trace> class BasicVcdWriter {
+public:
+  explicit BasicVcdWriter(std::ostream &out,
+                          std::string const &timescale = "1ns");
+
+  // the Trace must not change until write() finished
+  void addSignal(std::string const &name, Trace const &trace);
+
+  // the header and all value changes
+  void write();
+
+private:
+  // disabled
+  BasicVcdWriter(const BasicVcdWriter &other);
+  BasicVcdWriter &operator=(const BasicVcdWriter &other);
+
+  void write_header();
+
+  std::ostream &_out;
+  std::string _timescale;
+  std::vector<std::string> _names;
+  std::vector<Trace const *> _traces;
+};
+
+typedef BasicVcdWriter<Trace> VcdWriter;
+typedef BasicVcdWriter<NibbleTrace> NibbleVcdWriter;
+
+} // namespace svt
@@ -0,0 +1,277 @@
+#include "VersionedTrace.h"
+
+#include <trace/TraceFrameImpl.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace svt {
+
+namespace {
+
+// release the frame at pos, which may be compressed, but keep its slot
+template <class FrameSeq>
+void release_frame(FrameSeq &frames, typename FrameSeq::Pool &pool,
+                   std::size_t pos) {
+  if (frames.compressed(pos)) {
+    pool.destroy(frames.compressed_frame(pos));
+  } else {
+    pool.destroy(frames[pos]);
+  }
+}
+
+// append the frames [first, last) of from to to, a frame with too many
+// owners is copied into a frame of the given form
+template <class FrameSeq>
+void share_frames(FrameSeq const &from, std::size_t first, std::size_t last,
+                  FrameSeq &to, typename FrameSeq::Pool &pool,
+                  bool twoState) {
+  for (std::size_t i = first; i < last; ++i) {
+    if (!to.push_back_shared(from, i, pool)) {
+      typename FrameSeq::Frame *copy = pool.create(twoState);
+      copy->assign(*from[i]);
+      to.push_back(copy);
+    }
+  }
+}
+}
+
+template <class Trace>
+BasicVersionedTrace<Trace>::BasicVersionedTrace(TracePtr const &trace)
+    : _trace(trace), _oldest(0), _version(0), _suffix(0) {
+  assert(!_trace->_versioned && "the Trace has a BasicVersionedTrace already");
+  // the edits keep the frames by their position
+  _trace->_versioned = true;
+}
+
+template <class Trace> BasicVersionedTrace<Trace>::~BasicVersionedTrace() {
+  for (std::size_t i = 0; i < _edits.size(); ++i) {
+    release(_edits[i]);
+  }
+  _trace->_versioned = false;
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Version
+BasicVersionedTrace<Trace>::set(Bit const &value, DeltaTime const &time,
+                                TraceChangeMode changeMode) {
+  FrameSeq const &frames = _trace->_frames;
+  const Form form = form_of(*_trace);
+  const bool staysTwoState =
+      changeMode == TRACE_MERGE_BOTH &&
+      (form.numTwoStateValues < 2 ||
+       std::count(form.twoStateValues, form.twoStateValues + 2, value) > 0);
+
+  if (form.twoState && !staysTwoState) {
+    begin_full_edit();
+  } else {
+    // the frames BasicTrace::set thaws, for both writes of
+    // TRACE_KEEP_FUTURE_CYCLE
+    const std::size_t next = frames.upper_bound(time.packed());
+    const DeltaTime lastTime =
+        (changeMode & TRACE_KEEP_FUTURE_CYCLE) ? time + 1 : time;
+    const std::size_t last =
+        (changeMode & TRACE_CLEAR_FUTURE)
+            ? frames.size()
+            : std::min(frames.upper_bound(lastTime.packed()) + 2,
+                       frames.size());
+    begin_edit(next < 2 ? 0 : next - 2, last);
+  }
+  _trace->set(value, time, changeMode);
+  return end_edit();
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Version
+BasicVersionedTrace<Trace>::setRange(Bit const &value, DeltaTime const &begin,
+                                     DeltaTime const &end) {
+  FrameSeq const &frames = _trace->_frames;
+  if (_trace->isTwoState()) {
+    begin_full_edit();
+  } else {
+    const std::size_t first = frames.upper_bound(begin.packed());
+    const std::size_t last = frames.upper_bound(end.packed());
+    begin_edit(first < 2 ? 0 : first - 2, std::min(last + 2, frames.size()));
+  }
+  _trace->setRange(value, begin, end);
+  return end_edit();
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Version
+BasicVersionedTrace<Trace>::removeRange(DeltaTime const &begin,
+                                        DeltaTime const &end, bool shift) {
+  FrameSeq const &frames = _trace->_frames;
+  if (_trace->isTwoState()) {
+    begin_full_edit();
+  } else {
+    // shifting moves all frames after the range
+    const std::size_t first = frames.upper_bound(begin.packed());
+    const std::size_t last =
+        shift ? frames.size()
+              : std::min(frames.upper_bound(end.packed()) + 2, frames.size());
+    begin_edit(first < 2 ? 0 : first - 2, last);
+  }
+  _trace->removeRange(begin, end, shift);
+  return end_edit();
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Version
+BasicVersionedTrace<Trace>::removeDeltaCycles() {
+  begin_full_edit();
+  _trace->removeDeltaCycles();
+  return end_edit();
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Version
+BasicVersionedTrace<Trace>::clear() {
+  begin_full_edit();
+  _trace->clear();
+  return end_edit();
+}
+
+template <class Trace> void BasicVersionedTrace<Trace>::revert(Version version) {
+  assert(version >= oldest() && version <= newest());
+  for (; _version > version; --_version) {
+    apply(*_trace, *_edits[_version - 1 - _oldest], true);
+  }
+  for (; _version < version; ++_version) {
+    apply(*_trace, *_edits[_version - _oldest], false);
+  }
+}
+
+template <class Trace> bool BasicVersionedTrace<Trace>::undo() {
+  if (_version == oldest()) {
+    return false;
+  }
+  revert(_version - 1);
+  return true;
+}
+
+template <class Trace> bool BasicVersionedTrace<Trace>::redo() {
+  if (_version == newest()) {
+    return false;
+  }
+  revert(_version + 1);
+  return true;
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::TracePtr
+BasicVersionedTrace<Trace>::snapshot(Version version) const {
+  assert(version >= oldest() && version <= newest());
+  TracePtr theSnapshot = _trace->clone();
+  for (Version v = _version; v > version; --v) {
+    apply(*theSnapshot, *_edits[v - 1 - _oldest], true);
+  }
+  for (Version v = _version; v < version; ++v) {
+    apply(*theSnapshot, *_edits[v - _oldest], false);
+  }
+  return theSnapshot;
+}
+
+template <class Trace> void BasicVersionedTrace<Trace>::forget(Version version) {
+  assert(version >= oldest() && version <= _version);
+  const std::size_t count = version - _oldest;
+  for (std::size_t i = 0; i < count; ++i) {
+    release(_edits[i]);
+  }
+  _edits.erase(_edits.begin(), _edits.begin() + count);
+  _oldest = version;
+}
+
+template <class Trace>
+void BasicVersionedTrace<Trace>::begin_edit(std::size_t first,
+                                            std::size_t last) {
+  // the versions after the current one are lost
+  while (newest() > _version) {
+    release(_edits.back());
+    _edits.pop_back();
+  }
+
+  FrameSeq const &frames = _trace->_frames;
+  Edit *edit = new Edit;
+  edit->first = first;
+  edit->formBefore = form_of(*_trace);
+  share_frames(frames, first, last, edit->before, _trace->_frame_pool(),
+               _trace->isTwoState());
+  _edits.push_back(edit);
+  _suffix = frames.size() - last;
+
+  // the shared frames are copied by the Trace before it writes them
+  _trace->_sharesFrames = true;
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Version
+BasicVersionedTrace<Trace>::end_edit() {
+  FrameSeq const &frames = _trace->_frames;
+  Edit *edit = _edits.back();
+  assert(edit->first + _suffix <= frames.size() &&
+         "the edit changed frames outside of its range");
+  edit->formAfter = form_of(*_trace);
+  share_frames(frames, edit->first, frames.size() - _suffix, edit->after,
+               _trace->_frame_pool(), _trace->isTwoState());
+  return ++_version;
+}
+
+template <class Trace> void BasicVersionedTrace<Trace>::release(Edit *edit) {
+  FramePool &pool = _trace->_frame_pool();
+  for (std::size_t i = 0; i < edit->before.size(); ++i) {
+    release_frame(edit->before, pool, i);
+  }
+  for (std::size_t i = 0; i < edit->after.size(); ++i) {
+    release_frame(edit->after, pool, i);
+  }
+  delete edit;
+}
+
+template <class Trace>
+void BasicVersionedTrace<Trace>::apply(Trace &trace, Edit const &edit,
+                                       bool undo) const {
+  FrameSeq const &from = undo ? edit.before : edit.after;
+  const std::size_t count = (undo ? edit.after : edit.before).size();
+  Form const &form = undo ? edit.formBefore : edit.formAfter;
+  FrameSeq &frames = trace._frames;
+  FramePool &pool = trace._frame_pool();
+
+  for (std::size_t i = edit.first; i < edit.first + count; ++i) {
+    release_frame(frames, pool, i);
+  }
+  frames.splice(edit.first, edit.first + count, from, 0, from.size());
+  for (std::size_t i = 0; i < from.size(); ++i) {
+    if (!frames.share(edit.first + i, pool)) {
+      Frame *copy = pool.create(form.twoState);
+      copy->assign(*from[i]);
+      frames.replace(edit.first + i, copy);
+    }
+  }
+  set_form(trace, form);
+  trace._sharesFrames = true;
+}
+
+template <class Trace>
+typename BasicVersionedTrace<Trace>::Form
+BasicVersionedTrace<Trace>::form_of(Trace const &trace) {
+  Form form;
+  form.twoState = trace._twoState;
+  std::copy(trace._twoStateValues, trace._twoStateValues + 2,
+            form.twoStateValues);
+  form.numTwoStateValues = trace._numTwoStateValues;
+  return form;
+}
+
+template <class Trace>
+void BasicVersionedTrace<Trace>::set_form(Trace &trace, Form const &form) {
+  trace._twoState = form.twoState;
+  std::copy(form.twoStateValues, form.twoStateValues + 2,
+            trace._twoStateValues);
+  trace._numTwoStateValues = form.numTwoStateValues;
+}
+
+template class BasicVersionedTrace<Trace>;
+template class BasicVersionedTrace<NibbleTrace>;
+
+} // namespace svt
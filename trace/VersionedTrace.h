@@ -0,0 +1,120 @@
+#pragma once
+
+#include <time/DeltaTime.h>
+#include <trace/Bit.h>
+#include <trace/Trace.h>
+
+#include <vector>
+
+namespace svt {
+
+/**
+ * A Trace with a history of edits that can be undone and redone.
+ *
+ * Every edit gets a new version. For an edit the Trace keeps the frames
+ * the edit may change, the ones BasicTrace thaws around a write, before
+ * and after it. They are shared with the Trace, so the memory of a version
+ * is a few frames for a set() and grows with the range of a setRange().
+ * Only removeDeltaCycles(), clear(), a shifting removeRange() and the first
+ * write converting a two-state Trace to the general form keep all frames
+ * from the edit on. revert() swaps the
+ * kept frames back into the Trace, without copying any checkpoint.
+ *
+ * The history is linear: an edit after reverting to an older version drops
+ * the versions after it. The Trace must only be changed through this
+ * class.
+ **/
+template <class Trace> class BasicVersionedTrace {
+public:
+  typedef std::size_t Version;
+  typedef boost::intrusive_ptr<Trace> TracePtr;
+
+  // trace is version 0
+  explicit BasicVersionedTrace(TracePtr const &trace);
+  ~BasicVersionedTrace();
+
+  Trace const &trace() const { return *_trace; }
+
+  // the version of trace()
+  Version version() const { return _version; }
+  // the oldest and the newest version that can be reverted to
+  Version oldest() const { return _oldest; }
+  Version newest() const { return _oldest + _edits.size(); }
+
+  // the edits of Trace, each returns the new version
+  Version set(Bit const &value, DeltaTime const &time,
+              TraceChangeMode changeMode = TRACE_MERGE_BOTH);
+  Version setRange(Bit const &value, DeltaTime const &begin,
+                   DeltaTime const &end);
+  Version removeRange(DeltaTime const &begin, DeltaTime const &end,
+                      bool shift = false);
+  Version removeDeltaCycles();
+  Version clear();
+
+  // change trace() to version, which is in [oldest(), newest()]
+  void revert(Version version);
+  // revert to the previous and the next version, if there is one
+  bool undo();
+  bool redo();
+
+  /**
+   * A Trace holding version, sharing the frames of trace(). It is not
+   * changed by later edits.
+   **/
+  TracePtr snapshot() const { return _trace->clone(); }
+  TracePtr snapshot(Version version) const;
+
+  // drop the versions before version, it becomes the oldest one
+  void forget(Version version);
+
+private:
+  // disabled
+  BasicVersionedTrace(const BasicVersionedTrace &other);
+  BasicVersionedTrace &operator=(const BasicVersionedTrace &other);
+
+  typedef typename Trace::Frame Frame;
+  typedef typename Trace::FrameSeq FrameSeq;
+  typedef typename Trace::FramePool FramePool;
+
+  // the state of a Trace besides its frames that an edit may change
+  struct Form {
+    bool twoState;
+    Bit twoStateValues[2];
+    unsigned char numTwoStateValues;
+  };
+
+  // the frames [first, first + before.size()) of the older version are
+  // [first, first + after.size()) in the newer one
+  struct Edit {
+    std::size_t first;
+    FrameSeq before;
+    FrameSeq after;
+    Form formBefore;
+    Form formAfter;
+  };
+
+  // keep the frames [first, last) of the Trace for an edit
+  void begin_edit(std::size_t first, std::size_t last);
+  Version end_edit();
+  void begin_full_edit() { begin_edit(0, _trace->_frames.size()); }
+
+  void release(Edit *edit);
+  // replace the frames of one side of edit in trace by the other side
+  void apply(Trace &trace, Edit const &edit, bool undo) const;
+
+  static Form form_of(Trace const &trace);
+  static void set_form(Trace &trace, Form const &form);
+
+  TracePtr _trace;
+  std::vector<Edit *> _edits;
+  Version _oldest;
+  Version _version;
+
+  // the edit in progress
+  std::size_t _suffix;
+};
+
+typedef BasicVersionedTrace<Trace> VersionedTrace;
+typedef BasicVersionedTrace<NibbleTrace> NibbleVersionedTrace;
+
+} // namespace svt